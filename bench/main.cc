@@ -0,0 +1,67 @@
+// Times zest's own overhead on the suites `make bench` generates: the
+// S* groups of plain and fixture tests, and the Asserts group.
+#include <chrono>
+#include <cstdio>
+#include <time.h>
+#include <sys/resource.h>
+#include "zest.hh"
+
+#ifndef BENCH_ASSERTS
+#define BENCH_ASSERTS 0  // is_eq_ calls in each Asserts test
+#endif
+
+struct Quiet : zest::Reporter {};  // times the runner, not the console
+
+static double cpu_to_main() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t count(const char* pat) {
+  size_t n = 0;
+  zest::detail::Filter f(pat);
+  for (auto e = zest::Runner::entries; e; e = e->next)
+    n += f.match(e->group, e->title);
+  return n;
+}
+
+// Seconds to run the tests `pat` selects, or -1 if any failed.
+static double time_run(const char* pat, zest::Reporter* r) {
+  auto t0 = std::chrono::steady_clock::now();
+  int status = zest::run({.reporter = r, .times = false, .filter = {pat}});
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+  return status ? -1 : d.count();
+}
+
+int main() {
+  double startup = cpu_to_main();
+  size_t all = count("*"), plain = count("S*/plain*"),
+         fixed = count("S*/fixture*"), asserts = count("Asserts");
+  Quiet quiet;
+  time_run("S*/plain*", &quiet);  // warm up the allocator and caches
+  double tp = time_run("S*/plain*", &quiet);
+  double tf = time_run("S*/fixture*", &quiet);
+  double tc = time_run("S*/plain*", nullptr);  // to stdout
+  double ta = time_run("Asserts", &quiet);
+  if ((tp < 0) || (tf < 0) || (tc < 0) || (ta < 0)) {
+    fprintf(stderr, "bench: a generated test failed\n");
+    return 1;
+  }
+  double per_test = tp / plain;
+  double nassert = double(asserts) * BENCH_ASSERTS;
+  rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  fprintf(stderr, "%zu tests, %.0f assertions\n", all, nassert);
+  fprintf(stderr, "  startup      %8.1f ms  %8.1f ns/test\n",
+          startup * 1e3, startup * 1e9 / all);
+  fprintf(stderr, "  plain test   %8.1f ms  %8.1f ns/test\n",
+          tp * 1e3, per_test * 1e9);
+  fprintf(stderr, "  fixture test %8.1f ms  %8.1f ns/test\n",
+          tf * 1e3, tf * 1e9 / fixed);
+  fprintf(stderr, "  console      %8.1f ms  %8.1f ns/test\n",
+          tc * 1e3, tc * 1e9 / plain);
+  fprintf(stderr, "  is_eq        %8.1f ms  %8.2f ns/assertion\n",
+          ta * 1e3, (ta - asserts * per_test) * 1e9 / nassert);
+  fprintf(stderr, "  peak RSS     %8.1f MB\n", ru.ru_maxrss / 1024.0);
+}
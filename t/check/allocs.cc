@@ -0,0 +1,56 @@
+// Allocation counting. This file installs the counting operator new
+// for the whole program.
+#include <new>
+#include <string>
+#include <vector>
+#define ZEST_COUNT_ALLOCS
+#include "check.hh"
+
+TEST(Allocs, "is_allocs_le and is_bytes_le pass within the limit")
+{
+  is_allocs_le(0, (void)0);
+  is_allocs_le(1, delete new int(1));
+  is_allocs_le(1, std::vector<int> v(100));
+  is_bytes_le(0, (void)0);
+  is_bytes_le(400, std::vector<int> v(100));
+}
+
+TEST(Allocs, "count every form of new")
+{
+  struct alignas(64) Line { char c[64]; };
+  auto keep = [](auto* p) { zest::do_not_optimize(p); return p; };
+  size_t n = zest::detail::Allocs::count;
+  delete[] keep(new int[4]);
+  delete keep(new (std::nothrow) int(1));
+  delete[] keep(new (std::nothrow) int[4]);
+  delete keep(new Line);
+  delete[] keep(new Line[2]);
+  delete keep(new (std::nothrow) Line);
+  delete[] keep(new (std::nothrow) Line[2]);
+  is_eq(n + 7, zest::detail::Allocs::count);
+}
+
+TEST(SubjectAllocs, "is_allocs_le") { is_allocs_le(0, delete new int(1)); }
+TEST(SubjectAllocs, "is_bytes_le") { is_bytes_le(10, std::vector<int> v(100)); }
+
+TEST(Allocs, "report what the block allocated")
+{
+  auto r = subject("SubjectAllocs");
+  is_eq(1, r.status);
+  is_eq(true, r.has("FAIL: delete new int(1): 1 allocations, 4 bytes "
+                    "(is_allocs_le 0)"));
+  is_eq(true, r.has("FAIL: std::vector<int> v(100): 1 allocations, "
+                    "400 bytes (is_bytes_le 10)"));
+}
+
+TEST(Allocs, "passing assertions allocate nothing")
+{
+  std::string a(100, 'a'), b(100, 'a');
+  std::vector<int> v{1, 2, 3}, w{1, 2, 3};
+  is_allocs_le(0, is_eq(1, 1));
+  is_allocs_le(0, is_ne(1.5, 2.5));
+  is_allocs_le(0, is_lt(2, 1));
+  is_allocs_le(0, is_eq(a, b));
+  is_allocs_le(0, is_eq(std::string_view("abc"), "abc"));
+  is_allocs_le(0, is_eq_range(v, w));
+}
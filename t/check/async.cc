@@ -0,0 +1,99 @@
+// ASYNC_TEST: coroutine tests sharing their group's event loop.
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <thread>
+#include "check.hh"
+
+static std::atomic<bool> second_ran = false;
+
+// Unless they run one at a time, in forked workers.
+ASYNC_TEST(Async, "tests of a group share the loop")
+{
+  for (int i = 0; (i < 1000) && !second_ran; ++i)
+    co_await zest::async::yield();
+  is_eq(!zest::Runner::isolated, second_ran.load());
+}
+
+ASYNC_TEST(Async, "and run while others wait")
+{
+  second_ran = true;
+  co_await zest::async::sleep(0.001);
+}
+
+static zest::async::Task twice(int& n) {
+  co_await zest::async::yield();
+  n *= 2;
+}
+
+ASYNC_TEST(Async, "await helper tasks and futures")
+{
+  int n = 2;
+  co_await twice(n);
+  is_eq(4, n);
+  auto f = std::async(std::launch::async, [] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return 5;
+  });
+  co_await zest::async::ready(f);
+  is_eq(5, f.get());
+}
+
+static size_t threads() {
+  size_t n = 0;
+  for (auto& e : std::filesystem::directory_iterator("/proc/self/task"))
+    n += e.is_directory();
+  return n;
+}
+
+static std::promise<int> later;
+static size_t before = 0;
+
+// The second sets the first's future, so they need to share the loop,
+// in a group of their own, with no other group's threads about.
+static bool alone()
+{ return !zest::Runner::isolated && !zest::Runner::threaded; }
+
+ASYNC_TEST(AsyncReady, "awaits futures without a thread each")
+{
+  if (!alone()) { co_return; }
+  auto f = later.get_future();
+  before = threads();
+  co_await zest::async::ready(f);
+  is_eq(7, f.get());
+}
+
+ASYNC_TEST(AsyncReady, "so no more threads run while it waits")
+{
+  if (!alone()) { co_return; }
+  co_await zest::async::yield();
+  is_eq(before, threads());
+  later.set_value(7);
+}
+
+ASYNC_TEST(Async, "rethrow from helpers")
+{
+  auto boom = []() -> zest::async::Task { throw 1; co_return; };
+  bool caught = false;
+  try { co_await boom(); } catch (int) { caught = true; }
+  is_eq(true, caught);
+}
+
+ASYNC_TEST(SubjectAsync, "fails after a sleep")
+{
+  co_await zest::async::sleep(0.01);
+  is_eq(1, 2);
+}
+ASYNC_TEST(SubjectAsync, "passes") { co_await zest::async::yield(); }
+
+TEST(Async, "failures count against the awaiting test")
+{
+  for (auto args : {"", "-j2", "-i"}) {
+    auto r = subject(args + std::string(" SubjectAsync"));
+    is_eq(1, r.status);
+    is_eq(true, r.has(" ✗ fails after a sleep\n"));
+    is_eq(true, r.has(" ✓ passes\n"));
+    is_lt(r.out.find(" ✓ passes"), r.out.find(" ✗ fails after"));
+  }
+}
@@ -0,0 +1,124 @@
+// BENCH: an operation timed next to the tests.
+#include <chrono>
+#include <sched.h>
+#include "check.hh"
+
+static void spin() { for (int i = 0; i < 1000; ++i) zest::do_not_optimize(i); }
+
+BENCH(SubjectBench, "spins") { spin(); }
+
+TEST(Bench, "reports the median time of its body")
+{
+  auto r = subject("SubjectBench");
+  is_eq(0, r.status);
+  is_eq(true, r.has(" ✓ spins  "));
+  is_eq(true, r.has(" ns/op ±"));
+}
+
+// The baseline is keyed by group and title, and holds ns, MAD and the
+// sample count.
+static void write(const Temp& f, const char* line) {
+  FILE* o = fopen(f.path.c_str(), "w");
+  fputs(line, o);
+  fclose(o);
+}
+
+TEST(Bench, "records a baseline, and fails when slower than it")
+{
+  Temp base("baseline");
+  auto env = "ZEST_BASELINE=" + base.path;
+  is_eq(0, subject("SubjectBench", env).status);
+  is_eq(true, base.read().starts_with("SubjectBench\tspins\t"));
+  write(base, "SubjectBench\tspins\t1\t0\t10\n");
+  auto r = subject("SubjectBench", env);
+  is_eq(1, r.status);
+  is_eq(true, r.has("% slower than the baseline 1 ns/op\n"));
+  is_eq("SubjectBench\tspins\t1\t0\t10\n", base.read());
+}
+
+TEST(Bench, "keeps its baseline unless told to update it")
+{
+  Temp base("update");
+  write(base, "SubjectBench\tspins\t1e+09\t0\t10\n");
+  auto env = "ZEST_BASELINE=" + base.path;
+  auto fast = subject("SubjectBench", env);
+  is_eq(0, fast.status);
+  is_eq(true, fast.has("% vs baseline"));
+  is_eq("SubjectBench\tspins\t1e+09\t0\t10\n", base.read());
+  write(base, "SubjectBench\tspins\t1\t0\t10\n");
+  is_eq(0, subject("SubjectBench", "ZEST_UPDATE_BASELINE=1 " + env).status);
+  is_eq(false, base.read().starts_with("SubjectBench\tspins\t1\t"));
+}
+
+LATENCY_BENCH(SubjectLatency, "spins") { spin(); }
+TEST(SubjectQuantile, "under a second")
+{
+  is_p99_le(1.0, spin());
+  is_p999_le(std::chrono::seconds(1), spin());
+}
+TEST(SubjectQuantile, "under a picosecond") { is_p50_le(1e-12, spin()); }
+
+TEST(Bench, "reports the percentiles of every call")
+{
+  auto r = subject("SubjectLatency");
+  is_eq(0, r.status);
+  is_eq(true, r.has(" ✓ spins  p50 "));
+  is_eq(true, r.has("  p90 "));
+  is_eq(true, r.has("  p99 "));
+  is_eq(true, r.has("  p999 "));
+  is_eq(true, r.has("  max "));
+}
+
+TEST(Bench, "fails a test whose percentile is over its limit")
+{
+  auto r = subject("SubjectQuantile");
+  is_eq(1, r.status);
+  is_eq(true, r.has(" ✓ under a second\n"));
+  is_eq(true, r.has(" ✗ under a picosecond\n"));
+  is_eq(true, r.has("FAIL: spin(): p50 "));
+  is_eq(true, r.has(" > 0 ns  (p50 "));
+}
+
+static void spin(size_t n)
+{
+  for (size_t i = 0; i < n; ++i) zest::do_not_optimize(i);
+}
+SCALING_BENCH(SubjectScaling, "is linear", 1 << 10, 1 << 15, O_n)
+{ spin(zest::bench_size()); }
+SCALING_BENCH(SubjectScaling, "is not constant", 1 << 10, 1 << 15, O_1)
+{ spin(zest::bench_size()); }
+
+TEST(Bench, "fits how the time grows with n, and fails a faster class")
+{
+  auto r = subject("SubjectScaling");
+  is_eq(1, r.status);
+  is_eq(true, r.has(" ✓ is linear  O("));  // O(n) unless the host is noisy
+  is_eq(true, r.has(" ns × "));
+  is_eq(true, r.has("  n=1024..32768\n"));
+  is_eq(true, r.has(" ✗ is not constant\n"));
+  is_eq(true, r.has("FAIL: grows as O(n), expected O(1):\n    n=1024  "));
+  is_eq(true, r.has("\n    n=32768  "));
+}
+
+#ifdef __linux__
+static int cpus() {
+  cpu_set_t set;
+  return sched_getaffinity(0, sizeof set, &set) ? -1 : CPU_COUNT(&set);
+}
+static int unpinned = cpus();
+BENCH(SubjectPin, "runs on the CPU it was pinned to")
+{
+  is_eq(0, sched_getcpu());
+  is_eq(1, cpus());
+}
+TEST(SubjectPin, "then on all of them again") { is_eq(unpinned, cpus()); }
+
+TEST(Bench, "pins to a CPU while it runs")
+{
+  auto r = subject("--pin 0 SubjectPin");
+  if (r.has("zest: cannot pin to CPU 0")) { return; }  // not ours to use
+  is_eq(0, r.status);
+  is_eq(true, r.has(" ✓ runs on the CPU it was pinned to  "));
+  is_eq(true, r.has(" ✓ then on all of them again\n"));
+}
+#endif
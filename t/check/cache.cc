@@ -0,0 +1,36 @@
+// .cache: tests that passed in this same binary are not run again.
+#include <cstdlib>
+#include "check.hh"
+
+TEST(SubjectCache, "passes") { ZPRN("in passes"); }
+TEST(SubjectCache, "fails when told to")
+{
+  ZPRN("in fails");
+  is_eq(false, !!getenv("CHECK_FAIL"));
+}
+
+TEST(Cache, "skips the tests that passed before, but not failures")
+{
+  Temp c("cache");
+  auto args = "--cache " + c.path + " SubjectCache";
+  auto first = subject(args, "CHECK_FAIL=1");
+  is_eq(1, first.status);
+  is_eq(true, first.has("in passes\n"));
+  auto again = subject(args);
+  is_eq(0, again.status);
+  is_eq(false, again.has("in passes\n"));
+  is_eq(true, again.has("in fails\n"));
+  is_eq(true, again.has(" (1 cached)"));
+  auto last = subject(args);
+  is_eq(false, last.has("in fails\n"));
+  is_eq(true, last.has(" (2 cached)"));
+}
+
+TEST(Cache, "never skips a bench")
+{
+  Temp c("cache-bench");
+  subject("--cache " + c.path + " SubjectBench");
+  auto r = subject("--cache " + c.path + " SubjectBench");
+  is_eq(true, r.has(" ✓ spins  "));
+  is_eq(false, r.has("cached"));
+}
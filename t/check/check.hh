@@ -0,0 +1,61 @@
+// What the checks share. A check runs this binary again as
+// `check subject ARGS...`, which runs the Subject* groups picked by ARGS
+// with times off, and looks at what it printed.
+#pragma once
+#include <cstdio>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "zest.hh"
+
+inline const char* self;  // argv[0]
+
+// The reporter of a subject run with CHECK_TALLY set; see reporter.cc.
+inline zest::Reporter* tally;
+
+// What a run of the subjects printed, to stdout and stderr, and its
+// exit status. Shown when the check that ran it fails.
+struct Ran {
+  std::string out;
+  int status = -1;
+  size_t count(const std::string& s) const {
+    size_t n = 0;
+    for (auto i = out.find(s); i != out.npos; i = out.find(s, i + 1)) ++n;
+    return n;
+  }
+  bool has(const std::string& s) const { return count(s); }
+  ~Ran() {
+    auto t = zest::Runner::current;
+    if (t && t->failed) { ZOUT("--- subject output ---\n" << out); }
+  }
+};
+
+// `env` is put before the command, as in "ZEST_SHARD=1/2".
+inline Ran subject(const std::string& args, const std::string& env = "") {
+  Ran r;
+  auto cmd = env + " " + self + " subject " + args + " 2>&1";
+  FILE* p = popen(cmd.c_str(), "r");
+  if (!p) { return r; }
+  char buf[4096];
+  for (size_t n; (n = fread(buf, 1, sizeof buf, p));) r.out.append(buf, n);
+  int st = pclose(p);
+  r.status = WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+  return r;
+}
+
+// A scratch file named for the running test, removed when it goes.
+struct Temp {
+  std::string path;
+  explicit Temp(const char* name)
+    : path("/tmp/zest-check-" + std::to_string(getpid()) + "-" + name) {}
+  ~Temp() { remove(path.c_str()); }
+  std::string read() const {
+    std::string s;
+    if (FILE* f = fopen(path.c_str(), "r")) {
+      char buf[4096];
+      for (size_t n; (n = fread(buf, 1, sizeof buf, f));) s.append(buf, n);
+      fclose(f);
+    }
+    return s;
+  }
+};
@@ -0,0 +1,39 @@
+// .counters: cycles, IPC and misses from perf_event_open(2), where the
+// kernel allows it.
+#include <sstream>
+#include "check.hh"
+
+TEST(Counters, "shows each count per op, and leaves out the refused")
+{
+  zest::detail::Perf p;
+  double counts[] = {3000, 4500, 20, -1, 5};
+  std::copy(counts, counts + 5, p.count);
+  p.ops = 10;
+  std::ostringstream o;
+  zest::Runner::Console::counters(o, p);
+  is_eq(true, o.str().find("  300 cycles/op  1.50 IPC  2 br-miss/op"
+                           "  0.5 LLC-miss/op") != o.str().npos);
+  std::ostringstream whole;
+  p.ops = 1;
+  zest::Runner::Console::counters(whole, p);
+  is_eq(true, whole.str().find("  3e+03 cycles  1.50 IPC  20 br-miss"
+                               "  5 LLC-miss") != whole.str().npos);
+}
+
+TEST(Counters, "counts tests and benches, or warns once when it can't")
+{
+  for (auto mode : {"", "-i"}) {
+    auto args = std::string(mode) + " --counters SubjectBench SubjectCache";
+    auto r = subject(args);
+    is_eq(0, r.status);
+    if (r.has("zest: no hardware counters (")) {
+      is_eq(1u, r.count("zest: no hardware counters"));
+      is_eq(false, r.has(" cycles"));
+      continue;
+    }
+    is_eq(true, r.has(" ✓ passes  "));
+    is_eq(true, r.has(" cycles  "));
+    is_eq(true, r.has(" cycles/op  "));
+    is_eq(true, r.has(" IPC"));
+  }
+}
@@ -0,0 +1,38 @@
+// zest::main: patterns, --list, --repeat and bad arguments.
+#include "check.hh"
+
+TEST(SubjectPick, "alpha") { ZPRN("ran alpha"); }
+TEST(SubjectPick, "beta") { ZPRN("ran beta"); }
+TEST(SubjectPick2, "alpha") { ZPRN("ran alpha 2"); }
+
+TEST(Driver, "selects by group and title globs")
+{
+  is_eq("SubjectPick/alpha\nSubjectPick2/alpha\n",
+        subject("--list 'SubjectPick*/al*'").out);
+  is_eq("SubjectPick/beta\n",
+        subject("--list -x '*/alpha' 'SubjectPick*'").out);
+  is_eq("SubjectPick/alpha\nSubjectPick/beta\n",
+        subject("--list SubjectPick").out);
+}
+
+TEST(Driver, "selects by regex")
+{
+  is_eq("SubjectPick2/alpha\n", subject("--list -E '^SubjectPick2$'").out);
+  is_eq("SubjectPick/beta\n", subject("--list -E 'Pick$/^b'").out);
+  is_eq(2, subject("-E '('").status);
+}
+
+TEST(Driver, "repeats the run")
+{
+  auto r = subject("-r3 SubjectPick2");
+  is_eq(0, r.status);
+  is_eq(3u, r.count("ran alpha 2\n"));
+}
+
+TEST(Driver, "rejects unknown options")
+{
+  auto r = subject("--no-such-flag");
+  is_eq(2, r.status);
+  is_eq(true, r.has("unknown option --no-such-flag"));
+  is_eq(true, subject("--help").has("usage: "));
+}
@@ -0,0 +1,44 @@
+// --fail-fast and --max-failures: no new tests after N failures.
+#include "check.hh"
+
+TEST(SubjectFail, "first") { is_eq(1, 2); }
+TEST(SubjectFail, "second") { is_eq(3, 4); }
+TEST(SubjectFail, "third") { is_eq(5, 6); }
+TEST(SubjectFail2, "fourth") { is_eq(7, 8); }
+
+TEST(FailFast, "stops at the first failure")
+{
+  for (auto args : {"--fail-fast", "--fail-fast -j2"}) {
+    auto r = subject(args + std::string(" 'SubjectFail*'"));
+    is_eq(1, r.status);
+    is_le(2u, r.count("FAIL:"));  // -j2: one per thread at most
+    is_eq(true, r.has("(stopped: "));
+  }
+  auto r = subject("--fail-fast 'SubjectFail*'");
+  is_eq(1u, r.count("FAIL:"));
+  is_eq(true, r.has("(stopped: 3 not run)"));
+}
+
+// With -j2, the other worker may fail its test before it is stopped.
+TEST(FailFast, "stops forked workers too")
+{
+  auto one = subject("--fail-fast -i 'SubjectFail*'");
+  is_eq(1, one.status);
+  is_eq(1u, one.count("FAIL:"));
+  is_eq(true, one.has("(stopped: 3 not run)"));
+  auto two = subject("--fail-fast -i -j2 'SubjectFail*'");
+  is_eq(1, two.status);
+  is_ge(1u, two.count("FAIL:"));
+  is_le(2u, two.count("FAIL:"));
+  is_eq(true, two.has("(stopped: "));
+}
+
+TEST(FailFast, "stops after N with --max-failures")
+{
+  auto r = subject("--max-failures=2 'SubjectFail*'");
+  is_eq(2u, r.count("FAIL:"));
+  is_eq(true, r.has("(stopped: 2 not run)"));
+  auto max = subject("--max-failures=2 -i -j2 'SubjectFail*'");
+  is_ge(2u, max.count("FAIL:"));
+  is_le(3u, max.count("FAIL:"));
+}
@@ -0,0 +1,57 @@
+// Custom fixtures: built lazily for each test, or kept with persist.
+#include "check.hh"
+
+struct Counted : zest::TestCase {
+  static inline int built = 0, alive = 0;
+  int steps = 0;
+  Counted() { ++built; ++alive; }
+  ~Counted() { --alive; }
+  void before() override { ++steps; }
+  void after() override { if (steps != 2) fail("body did not run"); }
+};
+#define COUNTED_TEST(g, t) ZEST_TEST(Counted, g, t)
+
+COUNTED_TEST(Fixtures, "run before() then the body")
+{
+  auto& c = zest::current<Counted>();
+  is_eq(1, c.steps++);
+  is_eq(1, Counted::alive);  // only the running test's fixture
+}
+
+COUNTED_TEST(Fixtures, "are built for each test")
+{
+  auto& c = zest::current<Counted>();
+  is_eq(1, c.steps++);
+  is_eq(2, Counted::built);
+  is_eq(1, Counted::alive);
+}
+
+struct Zeroed : zest::TestCase { int n; double d; void* p; };
+
+ZEST_TEST(Zeroed, Fixtures, "start with their members zeroed")
+{
+  auto& z = zest::current<Zeroed>();
+  is_eq(0, z.n);
+  is_eq(0.0, z.d);
+  is_eq(nullptr, z.p);
+}
+
+struct Persist : zest::TestCase {
+  static constexpr bool persist = true;
+  int runs;  // value-initialized, then kept from run to run
+};
+#define PERSIST_TEST(g, t) ZEST_TEST(Persist, g, t)
+
+PERSIST_TEST(SubjectPersistA, "a") { ZPRN("a " << ++zest::current<Persist>().runs); }
+PERSIST_TEST(SubjectPersistB, "b") { ZPRN("b " << ++zest::current<Persist>().runs); }
+
+TEST(Fixtures, "with persist are kept for each test, under -j too")
+{
+  for (auto args : {"", "-j2"}) {
+    auto r = subject(args + std::string(" --repeat=3 'SubjectPersist*'"));
+    is_eq(0, r.status);
+    for (auto s : {"a 1\n", "a 2\n", "a 3\n", "b 1\n", "b 2\n", "b 3\n"})
+      is_eq(1u, r.count(s));
+    is_eq(0u, r.count(" 4\n"));
+  }
+}
@@ -0,0 +1,38 @@
+// .history: each test's last result and time, and .failed_first.
+#include <cstdlib>
+#include "check.hh"
+
+TEST(SubjectHistoryA, "passes") { is_eq(1, 1); }
+TEST(SubjectHistoryB, "fails when told to")
+{
+  is_eq(false, !!getenv("CHECK_FAIL"));
+}
+TEST(SubjectHistoryC, "passes") { is_eq(1, 1); }
+
+TEST(History, "records each test's last result and time")
+{
+  Temp h("history");
+  auto args = "--history " + h.path + " 'SubjectHistory*'";
+  is_eq(1, subject(args, "CHECK_FAIL=1").status);
+  auto s = h.read();
+  is_eq(0u, s.find("SubjectHistoryA\tpasses\t"));
+  is_ne(s.npos, s.find("\tpass\nSubjectHistoryB\tfails when told to\t"));
+  is_ne(s.npos, s.find("\tfail\nSubjectHistoryC\tpasses\t"));
+  is_eq(0, subject(args).status);
+  is_eq(s.npos, h.read().find("\tfail\n"));
+}
+
+TEST(History, "runs what failed last time first, then what is new")
+{
+  Temp h("failed-first");
+  auto args = "--history " + h.path;
+  subject(args + " -x SubjectHistoryC 'SubjectHistory*'", "CHECK_FAIL=1");
+  auto r = subject(args + " --failed-first --list 'SubjectHistory*'");
+  is_eq("SubjectHistoryB/fails when told to\n"
+        "SubjectHistoryC/passes\n"
+        "SubjectHistoryA/passes\n", r.out);
+  auto plain = subject(args + " --list 'SubjectHistory*'");
+  is_eq("SubjectHistoryA/passes\n"
+        "SubjectHistoryB/fails when told to\n"
+        "SubjectHistoryC/passes\n", plain.out);
+}
@@ -0,0 +1,26 @@
+// -i: groups in forked workers, where a crash fails only its test.
+#include <csignal>
+#include <stdexcept>
+#include "check.hh"
+
+TEST(SubjectCrash, "before") { is_eq(1, 1); }
+TEST(SubjectCrash, "segv") { std::raise(SIGSEGV); }
+TEST(SubjectCrash, "throws") { throw std::runtime_error("oops"); }
+TEST(SubjectCrash, "after") { is_eq(1, 1); }
+
+TEST(Isolate, "fails only the test that crashed")
+{
+  auto r = subject("-i SubjectCrash");
+  is_eq(1, r.status);
+  is_eq(true, r.has(" ✓ before"));
+  is_eq(true, r.has("FAIL: Killed by Segmentation fault"));
+  is_eq(true, r.has("FAIL: Uncaught exception"));
+  is_eq(true, r.has(" ✓ after"));
+  is_eq(2u, r.count("\n ✗ "));
+}
+
+TEST(Isolate, "prints the same with any number of workers")
+{
+  auto one = subject("-i -j1 SubjectCrash");
+  is_eq(one.out, subject("-i -j4 SubjectCrash").out);
+}
@@ -0,0 +1,23 @@
+// zest's own tests. Each file holds the checks of one feature, and the
+// Subject* groups they run in a child process; see check.hh.
+#include <cstring>
+#include <vector>
+#include "check.hh"
+
+int main(int argc, char** argv)
+{
+  self = argv[0];
+  bool sub = (argc > 1) && !strcmp(argv[1], "subject");
+  std::vector<char*> args{argv[0]};
+  std::string x = "-x", subjects = "Subject*";
+  if (!sub) { args.push_back(x.data()); args.push_back(subjects.data()); }
+  args.insert(args.end(), argv + 1 + sub, argv + argc);
+  zest::Options opt;
+  if (sub) {
+    opt.times = getenv("CHECK_TIMES");
+    opt.bench_time = 0.02;
+    opt.bench_max_cv = 0;  // so a noisy machine still compares them
+    if (getenv("CHECK_TALLY")) { opt.reporter = tally; }
+  }
+  return zest::main(args.size(), args.data(), opt);
+}
@@ -0,0 +1,39 @@
+// is_near_all: element-wise closeness of float and double spans.
+#include <cmath>
+#include <vector>
+#include "check.hh"
+
+TEST(Near, "passes within abs, rel or ulps")
+{
+  std::vector<double> e{1, 100, 0};
+  std::vector<double> a{1 + 1e-9, 100.001, 1e-7};
+  is_near_all(e, a, .abs = 1e-6, .rel = 1e-4);
+  float x = 1, y = std::nextafter(std::nextafter(x, 2.f), 2.f);
+  float ex[] = {x}, ay[] = {y};
+  is_near_all(ex, ay, .ulps = 2);
+  double n[] = {NAN};
+  is_near_all(n, n);  // NaN matches only NaN
+}
+
+TEST(SubjectNear, "abs")
+{
+  std::vector<double> e{1, 2}, a{1, 2.5};
+  is_near_all(e, a, .abs = 0.1);
+}
+TEST(SubjectNear, "ulps")
+{
+  float x = 1, y = std::nextafter(std::nextafter(x, 2.f), 2.f);
+  float ex[] = {x}, ay[] = {y};
+  is_near_all(ex, ay, .ulps = 1);
+}
+TEST(SubjectNear, "nan") { double e[] = {1}, a[] = {NAN}; is_near_all(e, a); }
+
+TEST(Near, "shows the worst element")
+{
+  auto r = subject("SubjectNear");
+  is_eq(1, r.status);
+  is_eq(true, r.has("FAIL: a ≈ e  (1 of 2 out of tolerance)\n"
+                    "    worst [1]: 2.5 vs 2  (abs 0.5, rel 0.25"));
+  is_eq(true, r.has(" ✗ ulps\n"));
+  is_eq(true, r.has(" ✗ nan\n"));
+}
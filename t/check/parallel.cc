@@ -0,0 +1,42 @@
+// -j: groups on worker threads, printed in order.
+#include <thread>
+#include "check.hh"
+
+TEST(SubjectOrderA, "a1") { ZPRN("in a1"); }
+TEST(SubjectOrderA, "a2") { ZPRN("in a2"); is_eq(1, 2); }
+TEST(SubjectOrderB, "b1") { ZPRN("in b1"); }
+TEST(SubjectOrderC, "c1") { ZPRN("in c1"); }
+ASYNC_TEST(SubjectOrderD, "d1") { co_await zest::async::yield(); ZPRN("in d1"); }
+ASYNC_TEST(SubjectOrderD, "d2") { ZPRN("in d2"); co_return; }
+
+TEST(Parallel, "prints the same serially, on threads and in workers")
+{
+  auto serial = subject("'SubjectOrder*'");
+  is_eq(1, serial.status);
+  is_eq(true, serial.has("[SubjectOrderA]\nin a1\n ✓ a1\nin a2\n"));
+  is_eq(serial.out, subject("-j4 'SubjectOrder*'").out);
+  is_eq(serial.out, subject("-i -j4 'SubjectOrder*'").out);
+  is_eq(serial.out, subject("-i -j1 'SubjectOrder*'").out);
+}
+
+TEST(Parallel, "counts assertions of helper threads against their test")
+{
+  auto t = &zest::current();
+  std::thread([&] { zest::Scope s(t); is_eq(1, 1); }).join();
+  std::thread(zest::inherit([t] { is_eq(t, &zest::current()); })).join();
+  is_eq(0, t->failed.load());
+}
+
+TEST(SubjectThreads, "fails from a helper thread")
+{
+  std::thread(zest::inherit([] { is_eq(1, 2); })).join();
+}
+
+TEST(Parallel, "fails the test whose helper thread failed")
+{
+  for (auto args : {"", "-j2", "-i"}) {
+    auto r = subject(args + std::string(" SubjectThreads"));
+    is_eq(1, r.status);
+    is_eq(true, r.has(" ✗ fails from a helper thread\n"));
+  }
+}
@@ -0,0 +1,28 @@
+// .profile: folded stacks of the CPU time, under each test.
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include "check.hh"
+
+TEST(SubjectProfile, "burns")
+{
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+  for (int i = 0; std::chrono::steady_clock::now() < end; ++i)
+    zest::do_not_optimize(i);
+}
+
+TEST(Profile, "files the samples under their test, also from workers")
+{
+  for (auto mode : {"", "-i"}) {
+    Temp p("profile");
+    auto r = subject("--profile " + p.path + " " + mode + " SubjectProfile");
+    is_eq(0, r.status);
+    std::istringstream folded(p.read());
+    size_t samples = 0;
+    for (std::string l; std::getline(folded, l);) {
+      if (!l.starts_with("SubjectProfile/burns;")) { continue; }
+      samples += atoi(l.c_str() + l.rfind(' ') + 1);  // "stack count"
+    }
+    is_ge(3u, samples);  // 50 at 1 ms, fewer where the kernel's tick is longer
+  }
+}
@@ -0,0 +1,38 @@
+// is_eq_range and is_eq_bytes.
+#include <cmath>
+#include <vector>
+#include "check.hh"
+
+TEST(Ranges, "is_eq_range passes on equal ranges of any kind")
+{
+  std::vector<int> v{1, 2, 3};
+  int a[] = {1, 2, 3};
+  is_eq_range(v, a);
+  is_eq_range(std::vector<int>{}, std::vector<int>{});
+}
+
+TEST(Ranges, "is_eq_bytes compares the first n bytes")
+{ is_eq_bytes("abcd", "abcX", 3); }
+
+TEST(SubjectRanges, "is_eq_range")
+{
+  std::vector<int> e{1, 2, 3}, a{1, 5, 3};
+  is_eq_range(e, a);
+}
+TEST(SubjectRanges, "is_eq_range sizes")
+{
+  std::vector<int> e{1, 2, 3}, a{1, 2};
+  is_eq_range(e, a);
+}
+TEST(SubjectRanges, "is_eq_bytes") { is_eq_bytes("abcd", "abXd", 4); }
+
+TEST(Ranges, "show where they differ")
+{
+  auto r = subject("SubjectRanges");
+  is_eq(1, r.status);
+  is_eq(true, r.has("FAIL: a == e  (1 of 3 differ, first at [1])\n"
+                    "    [0] 1 == 1\n  ✗ [1] 5 == 2\n    [2] 3 == 3\n"));
+  is_eq(true, r.has("size 2 != 3"));
+  is_eq(true, r.has("(1 of 4 differ, first at [2])"));
+  is_eq(true, r.has("  ✗ [2] 0x58 == 0x63\n"));
+}
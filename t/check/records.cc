@@ -0,0 +1,34 @@
+// .jsonl and .junit: a record of each test for CI.
+#include "check.hh"
+
+TEST(SubjectRecord, "passes") { is_eq(1, 1); }
+TEST(SubjectRecord, "fails \"quoted\" <here>") { is_eq(1, 2); }
+
+TEST(Records, "stream each test with its status and failures")
+{
+  for (auto mode : {"", "-i", "-j2"}) {
+    Temp j("jsonl"), x("junit");
+    auto r = subject("--jsonl " + j.path + " --junit " + x.path + " " + mode +
+                     " SubjectRecord");
+    is_eq(1, r.status);
+    auto json = j.read(), xml = x.read();
+    is_ne(json.npos, json.find(
+      "{\"group\":\"SubjectRecord\",\"title\":\"passes\","
+      "\"file\":\"t/check/records.cc\",\"line\":4,\"status\":\"pass\","));
+    is_ne(json.npos, json.find(
+      "\"title\":\"fails \\\"quoted\\\" <here>\","));
+    is_ne(json.npos, json.find(
+      "\"status\":\"fail\",\"wall\":"));
+    is_ne(json.npos, json.find(
+      "\"failures\":[{\"file\":\"t/check/records.cc\",\"line\":5,"
+      "\"message\":\"2 == 1  (2 == 1)\"}]}\n"));
+    is_ne(xml.npos, xml.find(
+      "  <testcase classname=\"SubjectRecord\" name=\"passes\" "
+      "file=\"t/check/records.cc\" line=\"4\" time=\""));
+    is_ne(xml.npos, xml.find(
+      "name=\"fails &quot;quoted&quot; &lt;here&gt;\""));
+    is_ne(xml.npos, xml.find(
+      "    <failure message=\"2 == 1  (2 == 1)\">t/check/records.cc:5: "));
+    is_eq(xml.size() - 27, xml.find("</testsuite>\n</testsuites>\n"));
+  }
+}
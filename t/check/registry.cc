@@ -0,0 +1,26 @@
+// Registration: groups run by name, their tests in the order written,
+// and tests may also be added at run time.
+#include "check.hh"
+
+TEST(SubjectRegistryB, "first") {}
+TEST(SubjectRegistryA, "z") {}
+TEST(SubjectRegistryA, "a") {}
+TEST(SubjectRegistryB, "second") {}
+
+static zest::TestCase later;
+static void nothing() {}
+static bool added = [] {
+  std::string g = "SubjectRegistryA", t = "added";  // copied by add()
+  zest::Runner::add(later, g, t, nothing, __FILE__, __LINE__);
+  g.assign(g.size(), '?'); t.assign(t.size(), '?');
+  return true;
+}();
+
+TEST(Registry, "sorts groups by name, and keeps the order of their tests")
+{
+  is_eq("SubjectRegistryA/z\n"
+        "SubjectRegistryA/a\n"
+        "SubjectRegistryA/added\n"
+        "SubjectRegistryB/first\n"
+        "SubjectRegistryB/second\n", subject("--list 'SubjectRegistry*'").out);
+}
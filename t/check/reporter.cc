@@ -0,0 +1,79 @@
+// Reporters: the hooks a Reporter gets, in-process and under -i.
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "check.hh"
+
+// Counts what it saw, to show which hooks ran in the parent.
+struct Tally : zest::Reporter {
+  int groups = 0, starts = 0, ends = 0, failures = 0;
+  void on_group_start(const zest::Str&, std::ostream&) override { ++groups; }
+  void on_test_start(zest::TestCase&) override { ++starts; }
+  void on_failure(zest::TestCase&, std::string_view, int,
+                  std::string_view) override { ++failures; }
+  void on_test_end(zest::TestCase&) override { ++ends; }
+  void on_summary(const zest::Summary& s, std::ostream& out) override {
+    out << "groups " << groups << ", starts " << starts << ", ends " << ends
+        << ", failures " << failures << ", nfail " << s.nfail << "\n";
+  }
+};
+static Tally counts;
+static bool installed = (tally = &counts);
+
+TEST(SubjectReport, "passes") { is_eq(1, 1); }
+TEST(SubjectReport, "fails twice") { is_eq(1, 2); is_eq(3, 4); }
+TEST(SubjectReport2, "fails") { is_eq(5, 6); }
+
+TEST(Reporter, "gets each hook")
+{
+  for (auto args : {"", "-j2", "-i", "-i -j2"}) {
+    auto r = subject(args + std::string(" 'SubjectReport*'"), "CHECK_TALLY=1");
+    is_eq(1, r.status);
+    is_eq(true, r.has("groups 2, starts 3, ends 3, failures 3, nfail 2\n"));
+  }
+}
+
+TEST(Reporter, "replaces the console")
+{
+  auto r = subject("'SubjectReport*'", "CHECK_TALLY=1");
+  is_eq(false, r.has("✓"));
+  is_eq(false, r.has("FAIL:"));
+}
+
+TEST(SubjectPrint, "in order")
+{
+  ZPRN("one");
+  printf("two\n");
+  std::cout << "three\n";
+  ZPRN("four");
+}
+
+TEST(SubjectPrint, "from threads")
+{
+  std::vector<std::thread> ts;
+  for (int k = 0; k < 4; ++k) ts.emplace_back(zest::inherit([] {
+    for (int i = 0; i < 20000; ++i) std::cout << "cout line\n";
+  }));
+  for (int i = 0; i < 20000; ++i) ZPRN("zprn line");
+  for (auto& t : ts) { t.join(); }
+}
+
+TEST(Reporter, "console keeps printf and std::cout in order")
+{
+  auto r = subject("'SubjectPrint/in order'");
+  is_eq(true, r.has("one\ntwo\nthree\nfour\n ✓ in order\n"));
+}
+
+// Lines from different threads may interleave, but no byte is lost
+// or written twice.
+TEST(Reporter, "console loses nothing written from threads")
+{
+  auto r = subject("'SubjectPrint/from threads'");
+  std::string rest = "\n[SubjectPrint]\n ✓ from threads\n"
+                     "\n┌──────┐\n│  OK  │\n└──────┘\n";
+  is_eq(rest.size() + 100000 * 10, r.out.size());
+  is_eq(20000, std::count(r.out.begin(), r.out.end(), 'z'));
+  is_eq(80000 + 1, std::count(r.out.begin(), r.out.end(), 'c'));
+}
@@ -0,0 +1,50 @@
+// .shard: each test in one of n shards, spread evenly.
+#include <set>
+#include <sstream>
+#include "check.hh"
+
+static zest::TestCase empty;
+static void nothing() {}
+
+static bool added = [] {
+  for (int i = 0; i < 60; ++i)
+    zest::Runner::add(empty, "SubjectShard" + std::to_string(i % 3),
+                      "t" + std::to_string(i), nothing, __FILE__, __LINE__);
+  // The low bit of plain FNV-1a is the xor of the bytes' low bits, so
+  // it put all of these in one half.
+  for (int d = 0; d < 10; ++d)
+    zest::Runner::add(empty, "SubjectTwins", "n=" + std::to_string(d * 11),
+                      nothing, __FILE__, __LINE__);
+  return true;
+}();
+
+TEST(Shard, "puts each test in one shard, about evenly")
+{
+  auto all = subject("--list 'SubjectShard*'");
+  is_eq(60u, all.count("\n"));
+  for (int n : {2, 3, 4, 5, 6}) {
+    std::set<std::string> seen;
+    for (int i = 1; i <= n; ++i) {
+      auto env = "ZEST_SHARD=" + std::to_string(i) + "/" + std::to_string(n);
+      auto r = subject("--list 'SubjectShard*'", env);
+      std::istringstream lines(r.out);
+      size_t k = 0;
+      for (std::string l; std::getline(lines, l); ++k) {
+        is_eq(true, all.has(l + "\n"));
+        is_eq(true, seen.insert(l).second);
+      }
+      is_ge(60u / n / 2, k);
+      is_le(60u / n * 2, k);
+    }
+    is_eq(60u, seen.size());
+  }
+}
+
+TEST(Shard, "mixes the hash before taking it modulo n")
+{
+  auto a = subject("--list SubjectTwins", "ZEST_SHARD=1/2");
+  auto b = subject("--list SubjectTwins", "ZEST_SHARD=2/2");
+  is_ne(0u, a.count("\n"));
+  is_ne(0u, b.count("\n"));
+  is_eq(10u, a.count("\n") + b.count("\n"));
+}
@@ -0,0 +1,58 @@
+// zest::shared<T>(): one object per group, gone after its last test.
+#include <csignal>
+#include <unistd.h>
+#include "check.hh"
+
+struct Db {
+  int opened = 0;
+  explicit Db(int n) : opened(n) {}
+};
+
+TEST(Shared, "is built from the first call's args")
+{ is_eq(7, zest::shared<Db>(7).opened++); }
+
+TEST(Shared, "is the same object for the rest of the group")
+{ is_eq(8, zest::shared<Db>(100).opened); }
+
+TEST(Shared2, "is another object in another group")
+{ is_eq(3, zest::shared<Db>(3).opened); }
+
+// What its destructor prints belongs at the end of its group.
+struct Teardown {
+  const char* group = "?";
+  ~Teardown() { ZPRN("teardown " << group); }
+};
+
+TEST(SubjectTeardownA, "a1") { zest::shared<Teardown>().group = "A"; }
+TEST(SubjectTeardownA, "a2") { is_eq(1, 1); }
+TEST(SubjectTeardownB, "b1") { zest::shared<Teardown>().group = "B"; }
+TEST(SubjectTeardownC, "c1") { is_eq(1, 1); }
+
+TEST(Shared, "is torn down at the end of its group")
+{
+  for (auto args : {"", "-j4", "-i -j4"}) {
+    auto r = subject(args + std::string(" 'SubjectTeardown*'"));
+    is_eq(0, r.status);
+    is_eq(1u, r.count("teardown A\n"));
+    is_lt(r.out.find("[SubjectTeardownB]"), r.out.find("teardown A"));
+    is_lt(r.out.find("teardown A"), r.out.find(" ✓ a2"));
+    is_lt(r.out.find("[SubjectTeardownC]"), r.out.find("teardown B"));
+  }
+}
+
+struct Crashes { ~Crashes() { std::raise(SIGSEGV); } };
+struct Hangs { ~Hangs() { for (;;) pause(); } };
+
+TEST(SubjectBadTeardown, "crashes after it") { zest::shared<Crashes>(); }
+TEST(SubjectBadTeardown2, "hangs after it") { zest::shared<Hangs>(); }
+
+TEST(Shared, "fails its group when the teardown crashes or hangs")
+{
+  auto r = subject("-i SubjectBadTeardown");
+  is_eq(1, r.status);
+  is_eq(true, r.has(" ✓ crashes after it\n ✗ (teardown)"));
+  is_eq(true, r.has("FAIL: Killed by Segmentation fault in the group's"));
+  auto h = subject("-i SubjectBadTeardown2", "ZEST_TIMEOUT=0.2");
+  is_eq(1, h.status);
+  is_eq(true, h.has("FAIL: Timed out after 0.2 s in the group's teardown"));
+}
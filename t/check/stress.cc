@@ -0,0 +1,37 @@
+// zest::stress: one body run on many threads at once.
+#include <atomic>
+#include "check.hh"
+
+TEST(Stress, "calls the body on each thread")
+{
+  std::atomic<int> calls = 0;
+  size_t n = zest::stress({.threads = 4, .iters = 25}, [&](int) { ++calls; });
+  is_eq(100u, n);
+  is_eq(100, calls.load());
+}
+
+TEST(Stress, "passes each thread its index")
+{
+  std::atomic<int> seen[4] = {};
+  zest::stress({.threads = 4, .iters = 10}, [&](int i) { ++seen[i]; });
+  for (auto& s : seen) { is_eq(10, s.load()); }
+}
+
+TEST(Stress, "stops after .seconds")
+{
+  size_t n = zest::stress({.threads = 2, .seconds = 0.05}, [](int) {});
+  is_gt(2u, n);
+}
+
+TEST(SubjectStress, "fails on one thread")
+{ zest::stress({.threads = 4, .iters = 5}, [](int i) { is_ne(2, i); }); }
+TEST(SubjectStress, "throws")
+{ zest::stress({.threads = 2}, [](int i) { if (i) throw 1; }); }
+
+TEST(Stress, "stops its threads once the test fails")
+{
+  auto r = subject("SubjectStress");
+  is_eq(1, r.status);
+  is_eq(1u, r.count("FAIL: i != 2"));
+  is_eq(true, r.has("FAIL: Uncaught exception on stress thread 1\n"));
+}
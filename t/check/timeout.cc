@@ -0,0 +1,37 @@
+// Per-test timeouts: a watchdog fails or aborts an overrunning test.
+#include <thread>
+#include "check.hh"
+
+struct Slow : zest::TestCase { Slow() { timeout = 0.2; } };
+
+ZEST_TEST(Slow, SubjectHang, "sleeps")
+{ std::this_thread::sleep_for(std::chrono::seconds(5)); }
+TEST(SubjectHang, "after") { is_eq(1, 1); }
+
+TEST(Timeout, "kills an isolated test that overruns")
+{
+  auto r = subject("-i SubjectHang");
+  is_eq(1, r.status);
+  is_eq(true, r.has("FAIL: Timed out after 0.2 s"));
+  is_eq(true, r.has(" ✓ after"));
+}
+
+TEST(Timeout, "aborts an in-process run, naming the test")
+{
+  auto r = subject("SubjectHang");
+  is_ne(0, r.status);
+  is_eq(true, r.has("TIMEOUT: SubjectHang: sleeps did not finish in 0.2 s"));
+  is_eq(false, r.has(" ✓ after"));
+}
+
+TEST(SubjectNap, "sleeps")
+{ std::this_thread::sleep_for(std::chrono::seconds(5)); }
+
+TEST(Timeout, "can be set for the whole run")
+{
+  auto nap = subject("-i SubjectNap", "ZEST_TIMEOUT=0.1");
+  is_eq(1, nap.status);
+  is_eq(true, nap.has("FAIL: Timed out after 0.1 s"));
+  auto hang = subject("-i 'SubjectHang/sleeps'", "ZEST_TIMEOUT=0.1");
+  is_eq(true, hang.has("FAIL: Timed out after 0.2 s"));  // its own wins
+}
@@ -0,0 +1,59 @@
+// Per-test times and the slowest tests, and how failed tests print.
+#include <csignal>
+#include <thread>
+#include "check.hh"
+
+TEST(SubjectTimed, "fast") { is_eq(1, 1); }
+TEST(SubjectTimed, "slow")
+{ std::this_thread::sleep_for(std::chrono::milliseconds(30)); }
+TEST(SubjectTimed, "fails") { is_eq(7, 8); }
+
+TEST(Timing, "puts each test's time on its line")
+{
+  auto r = subject("SubjectTimed", "CHECK_TIMES=1");
+  for (auto t : {" ✓ fast  ", " ✓ slow  ", " ✗ fails  "}) {
+    auto x = r.out.find(t);
+    if (!is_ne(r.out.npos, x)) { continue; }
+    auto line = r.out.substr(x, r.out.find('\n', x) - x);
+    is_eq(true, line.ends_with("s"));  // µs, ms or s
+  }
+  is_lt(r.out.find("FAIL: 8 == 7"), r.out.find(" ✗ fails  "));
+}
+
+TEST(Timing, "lists the slowest tests")
+{
+  auto r = subject("SubjectTimed", "ZEST_SLOWEST=1");
+  auto x = r.out.find("[1 slowest]\n");
+  if (!is_ne(r.out.npos, x)) { return; }
+  auto line = r.out.substr(x + 12, r.out.find('\n', x + 12) - x - 12);
+  is_eq(true, line.ends_with("  SubjectTimed: slow"));
+  is_eq(true, line.find("cpu ") != line.npos);
+}
+
+TEST(SubjectThrow, "passes") { is_eq(1, 1); }
+TEST(SubjectThrow, "throws") { is_eq(1, 2); throw 1; }
+ASYNC_TEST(SubjectThrowAsync, "throws") { co_await zest::async::yield(); throw 1; }
+
+TEST(Timing, "prints a test that throws before the run ends")
+{
+  for (auto g : {"SubjectThrow", "SubjectThrowAsync"}) {
+    for (auto args : {"", "-j2"}) {
+      auto r = subject(args + std::string(" ") + g);
+      is_ne(0, r.status);
+      is_eq(true, r.has(" ✗ throws\n"));
+      is_eq(true, r.has("FAIL: Uncaught exception"));
+    }
+  }
+  is_eq(true, subject("SubjectThrow").has("FAIL: 2 == 1"));
+}
+
+TEST(SubjectSegv, "fails") { is_eq(1, 2); }
+TEST(SubjectSegv, "crashes") { std::raise(SIGSEGV); }
+
+TEST(Timing, "prints a failure before a later crash")
+{
+  auto r = subject("SubjectSegv");
+  is_ne(0, r.status);
+  is_eq(true, r.has("[SubjectSegv]\n ✗ fails\n"));
+  is_eq(true, r.has("FAIL: 2 == 1"));
+}
@@ -1,3 +1,5 @@
+#include <cstring>
+#include <iostream>
 #include "zest.hh"
 
 const char* fake_fail =
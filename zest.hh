@@ -23,6 +23,12 @@
 **
 **        is_thrown(type, body);    // expect body to throw type
 **
+**        is_eq_range(expected, actual);     // same size and elements
+**        is_eq_bytes(expected, actual, n);  // memcmp of n bytes
+**
+**        // float/double arrays, each element within any tolerance
+**        is_near_all(expected, actual, .abs = 1e-6, .rel = 1e-5, .ulps = 4);
+**
 **        // assertions return booleans
 **        bool ok = is_eq(expected, actual);
 **      }
@@ -37,12 +43,99 @@
 **
 **      is_thrown(expected_error_type, body)
 **
+**  And limit how much a piece of code allocates on this thread:
+**
+**      is_allocs_le(max_count, body)  // at most max_count operator new
+**      is_bytes_le(max_bytes, body)   // at most max_bytes in total
+**
+**  These need zest's counting operator new, which replaces the global
+**  one. Install it in exactly one file of the test program:
+**
+**      #define ZEST_COUNT_ALLOCS
+**      #include "zest.hh"
+**
+**  In a suite of many files, each one compiles the whole runner. To
+**  compile it once, build every test file with -DZEST_SPLIT, which
+**  leaves only the interface, and define the rest in one file:
+**
+**      #define ZEST_IMPLEMENTATION
+**      #include "zest.hh"
+**
+**  `make split` builds the tests this way. The implementation brings
+**  in <iostream>, <vector>, <sstream>, <optional>, <thread>, <chrono>,
+**  <regex> and the POSIX headers, so test files that use std::cout,
+**  containers or threads include them themselves.
+**
 **
 **  Run all the tests:
 **
 **      int exit_status = zest::run();  // 0=pass / 1=fail
 **
 **
+**  Each passing test shows its wall time. To hide it, or to list the
+**  slowest tests (wall and CPU time) before the summary:
+**
+**      zest::run({.times = false});
+**      zest::run({.slowest = 10});  // or set $ZEST_SLOWEST
+**
+**
+**  Split the tests across machines, running shard i of n (1 <= i <= n):
+**
+**      zest::run({.shard = {3, 16}});  // or set $ZEST_SHARD=3/16
+**
+**  Each test lands in a shard chosen by a hash of its group and title,
+**  after skip/only are applied. To balance shards by time instead,
+**  record durations in a history file and give every node a copy of
+**  the same file:
+**
+**      zest::run({.history = "times.tsv"});  // or set $ZEST_HISTORY
+**      zest::run({.shard = {3, 16}, .shard_by_time = true,
+**                 .history = "times.tsv"});
+**
+**  The history also keeps whether each test passed last time. To see
+**  regressions sooner, run the groups with a test that failed last
+**  time first, then groups with tests it has never seen, then the rest:
+**
+**      zest::run({.history = "times.tsv", .failed_first = true});
+**      // or set $ZEST_FAILED_FIRST, or pass --failed-first to zest::main
+**
+**  When a test binary is relinked but unchanged, skip the tests that
+**  already passed in it. The cache is keyed by a hash of the contents
+**  of the binary, plus group and title:
+**
+**      zest::run({.cache = ".zest-cache"});  // or $ZEST_CACHE / --cache
+**
+**  Cached tests count as passed, and the summary says how many there
+**  were. Benches are never cached, and entries unused for a week are
+**  dropped. Use it only for tests that depend on nothing but the code:
+**  a change to input files, the environment or a shared fixture's
+**  order within a group is not seen.
+**
+**
+**  Run groups in parallel on a pool of worker threads:
+**
+**      zest::run({.jobs = 8});  // or set $ZEST_JOBS / -1 = one per core
+**
+**  Tests within a group still run in order on one thread, and the
+**  output is printed group by group exactly as a serial run prints it.
+**
+**  Run groups in forked worker processes, so that a crash only fails
+**  the test that crashed and the run goes on:
+**
+**      zest::run({.jobs = 8, .isolate = true});  // or set $ZEST_ISOLATE
+**
+**  In this mode an uncaught exception fails its test instead of
+**  ending the run.
+**
+**  Limit how long each test may take, from before() to after():
+**
+**      zest::run({.timeout = 30});  // seconds / or set $ZEST_TIMEOUT
+**
+**  A TestCase subclass can set its own `timeout` in its constructor.
+**  In isolated mode an overrunning test is killed and fails. Otherwise
+**  the run aborts, naming the test and its file:line.
+**
+**
 **  Skip certain groups:
 **
 **      zest::skip("GroupName");   // call this before zest::run()
@@ -55,6 +148,115 @@
 **      zest::only("OhAlsoThisOne");
 **
 **
+**  Or let the command line pick the tests:
+**
+**      int main(int argc, char** argv) { return zest::main(argc, argv); }
+**
+**      ./test Parser              # every test in group Parser
+**      ./test 'Parser/utf*'       # GROUP/TITLE globs, as in fnmatch(3)
+**      ./test -x Slow             # all but group Slow
+**      ./test -E '^Pars/^empty'   # regexes, searched for in each name
+**      ./test --list Parser       # print GROUP/TITLE of each match
+**      ./test --repeat=100 -j8 Flaky/
+**      ./test --fail-fast         # or --max-failures=N
+**
+**  With `.max_failures = N` (or $ZEST_MAX_FAILURES), the run stops
+**  once N tests have failed: no new tests start, thread workers finish
+**  the test they are in, forked workers are killed, and the summary
+**  says how many tests were left unrun.
+**
+**  `zest::main(argc, argv, opt)` starts from `opt`, and the same
+**  patterns can be given to zest::run() as `.filter`. Patterns are
+**  compiled once and matched before any fixture is built.
+**  Run `./test --help` for all flags.
+**
+**
+**  Benchmark an operation next to the tests:
+**
+**      BENCH(GroupName, "description")
+**      {
+**        zest::do_not_optimize(hash(key));  // keep the result alive
+**        zest::clobber_memory();            // force pending writes
+**      }
+**
+**  The body runs as one operation, enough times to fill each sample,
+**  after a few warmup samples. It reports the median ns/op and the
+**  median absolute deviation. skip/only apply to benches too. Tune
+**  the measurement through the options to zest::run():
+**
+**      zest::run({.bench_time = 0.5, .bench_reps = 10, .bench_warmup = 2});
+**
+**  Gate performance regressions against a baseline file:
+**
+**      zest::run({.baseline = "bench.tsv"});  // or set $ZEST_BASELINE
+**
+**  New benches are recorded in the file. A bench that is more than
+**  .bench_threshold (10%) slower than its recorded median, by over
+**  three standard errors, fails. Set .update_baseline = true or
+**  $ZEST_UPDATE_BASELINE to record the current results instead.
+**
+**  A bench whose coefficient of variation (from the MAD) is over
+**  .bench_max_cv (10%) is shown as unreliable, and is neither compared
+**  with nor recorded in the baseline. Warmup goes on past .bench_warmup
+**  samples until three in a row agree within half that. On a shared
+**  host, pin benches to one CPU (and run them with -j1):
+**
+**      zest::run({.bench_cpu = 3});  // or $ZEST_BENCH_CPU / --pin 3
+**
+**  The first pinned bench warns when that CPU scales its frequency,
+**  turbo boost is on, or the load average is over half the CPUs.
+**
+**  For tail latency, time every call instead, into a log-linear
+**  histogram (buckets about 3% wide), and show p50/p90/p99/p999/max:
+**
+**      LATENCY_BENCH(Queue, "push") { q.push(1); }
+**
+**  Or gate a percentile from a test. The limit is in seconds, or any
+**  std::chrono duration; the body is timed for .bench_time:
+**
+**      using namespace std::chrono_literals;
+**      is_p99_le(2us, q.push(1));  // also is_p50_le, is_p90_le, is_p999_le
+**
+**  Check how a bench scales by running it at n = lo, 2·lo .. hi. The
+**  body reads n from zest::bench_size(), and the ns/op are fitted to
+**  each of O(1), O(log n), O(n), O(n log n) and O(n²):
+**
+**      SCALING_BENCH(Sort, "std::sort", 1 << 10, 1 << 20, O_n_log_n)
+**      {
+**        static std::vector<int> in;
+**        size_t n = zest::bench_size();
+**        if (in.size() != n) { in = shuffled(n); }
+**        auto v = in;
+**        std::sort(v.begin(), v.end());
+**      }
+**
+**  It shows the class that fits best and its constant in ns, and fails
+**  when a class growing faster than the expected one fits at least
+**  twice as well. Pass O_auto to only report. The sizes share
+**  .bench_time, and are not kept in the baseline.
+**
+**  On Linux, count cycles, IPC, branch misses and L1/LLC misses with
+**  perf_event_open(2). Benches show them per op over the measured
+**  samples, tests over the whole body, and only on this thread:
+**
+**      zest::run({.counters = true});  // or $ZEST_COUNTERS / --counters
+**
+**  Where the kernel refuses (see perf_event_paranoid, or a VM without
+**  a PMU), zest warns once and runs without them.
+**
+**
+**  Find which tests, and which functions in them, take the CPU time:
+**
+**      zest::run({.profile = "tests.folded"});  // or $ZEST_PROFILE / --profile
+**      // then: flamegraph.pl tests.folded >tests.svg
+**
+**  Every ms of CPU time, on SIGPROF, the stack of the thread using it
+**  is sampled and filed under its test, as the root frame Group/title.
+**  Names come from dladdr(3), so link with -rdynamic to see functions
+**  of the test binary and not just offsets. Forked workers append
+**  their samples when they finish; those of a killed worker are lost.
+**
+**
 **  Allow test cases to access private members of a class:
 **
 **      class MyClass
@@ -76,6 +278,56 @@
 **      zest::current()  // TestCase& / throws if no current test
 **
 **
+**  Make assertions from threads started by a test:
+**
+**      std::thread t(zest::inherit([&]{ is_eq(1, x); }));
+**
+**      auto tc = &zest::current();
+**      std::thread u([&, tc]{ zest::Scope s(tc); is_eq(2, y); });
+**
+**  The current test is thread-local; zest::inherit and zest::Scope
+**  hand it to other threads. Failures are counted atomically, and
+**  each failure message is printed whole.
+**
+**  To hammer code from many threads at once, zest::stress starts
+**  `.threads` (default: one per core) threads, holds them at a start
+**  barrier, then calls the body on each for `.iters` calls or
+**  `.seconds`, whichever ends first, or until the test fails:
+**
+**      TEST(Queue, "mpmc")
+**      {
+**        Queue q;
+**        size_t n = zest::stress({.threads = 8, .seconds = 1},
+**                                [&](int thread, size_t i) {
+**          if (thread % 2) q.push(i); else q.try_pop();
+**        });
+**      }
+**
+**  The body may take just `(int thread)`. With neither limit, it is
+**  called once per thread. stress returns the total number of calls.
+**
+**
+**  Write tests as coroutines, and await from them:
+**
+**      zest::async::Task fetch(Client& c) { co_await c.get("/"); ... }
+**
+**      ASYNC_TEST(Http, "fetch")
+**      {
+**        co_await zest::async::sleep(0.1);  // let other tests run
+**        co_await zest::async::ready(fut);  // a std::future, unblocked
+**        co_await fetch(client);            // helpers: zest::async::Task
+**        is_eq(200, status);
+**      }
+**
+**  Consecutive async tests of a group run on one event loop, up to
+**  .async_jobs (16) at a time, and their output is printed in order.
+**  Each co_await resumes with the right current test, so assertions
+**  count against it. An awaitable from other code may resume the
+**  coroutine on its own thread, or post it back to the test's loop
+**  with `zest::current<zest::Async>().post(handle)`. With
+**  .isolate, or .async_jobs = 1, async tests run one at a time.
+**
+**
 **
 **  COLORS
 **  ------
@@ -90,6 +342,43 @@
 **
 **
 **
+**  REPORTERS
+**  ---------
+**
+**  Results go to a zest::Reporter, which has a hook for each event
+**  of a run: on_group_start, on_test_start, on_failure, on_test_end,
+**  on_group_end and on_summary. Override the ones you need:
+**
+**      struct Dots : zest::Reporter {
+**        void on_test_end(zest::TestCase& t) override
+**        { *t.out << (t.failed ? "F" : "."); }
+**      };
+**
+**      Dots dots;
+**      zest::run({.reporter = &dots});
+**
+**  The default reporter, zest::Console, writes through stdout's buffer,
+**  in order with printf and std::cout from tests, and flushes it at
+**  group boundaries and on failure rather than on every line.
+**
+**  With .isolate, the hooks are called in the parent process as the
+**  workers report each test. The TestCase they get is a stand-in for
+**  the fixture, which lives in the worker: it has the test's names,
+**  times, failures, details() and counters, but not its members.
+**
+**  For CI, also stream a record of each test as it ends, with its
+**  times and each failure's file:line and message:
+**
+**      zest::run({.jsonl = "tests.jsonl", .junit = "tests.xml"});
+**      // or $ZEST_JSONL, $ZEST_JUNIT, --jsonl FILE, --junit FILE
+**
+**  Records are handed to a writer thread through a lock-free queue,
+**  and flushed as they are written, so a killed run leaves the tests
+**  that finished. They come in the order tests end, in any mode, and
+**  JUnit puts them all in one <testsuite> with the group as classname.
+**
+**
+**
 **  CUSTOM TEST TYPES
 **  -----------------
 **
@@ -110,7 +399,7 @@
 **
 **      fail("message");
 **
-**  With no argument, fail() returns the output stream:
+**  With no argument, fail() returns a locked handle to the output stream:
 **
 **      fail() << a << b << c << std::endl;  // (don't forget std::endl)
 **
@@ -163,41 +452,89 @@
 **  and "failing test" will fail with a standard failure output:
 **
 **      /path/to/file:137: FAIL: Count too low!
+**
+**  Each test gets its own fixture, built just before before() and
+**  destroyed right after after(), so a suite only holds the fixtures
+**  of the tests that are running. A fixture type can opt out, and keep
+**  one object for each of its tests for the whole program:
+**
+**      class CounterTestCase : public zest::TestCase
+**      {
+**        public:
+**          static constexpr bool persist = true;
+**          ...
+**      };
+**
+**  For setup that is too slow to repeat for every test, like loading a
+**  large dataset or starting a server, use `zest::shared<T>(args...)`.
+**  The first call in a group builds a T from `args`; later calls in
+**  the same group return that same T, and it is destroyed after the
+**  group's last test:
+**
+**      struct Server { Server(int port); ... };
+**
+**      TEST(Api, "get") { auto& s = zest::shared<Server>(8080); ... }
+**      TEST(Api, "put") { auto& s = zest::shared<Server>(8080); ... }
+**
+**  A group's tests always run one after another, so this also works
+**  with `.jobs`. Each group gets its own T. With `.isolate`, a worker
+**  that crashes takes its T with it, and the worker taking over the
+**  rest of the group builds a new one. What zest::out() prints from
+**  its destructor comes out at the end of its group, in every mode.
+**  With `.isolate`, a crash there fails the group as a test named
+**  "(teardown)", and so does overrunning the longest timeout of the
+**  group's tests.
 */
 
+#include <atomic>
+#include <cmath>
+#include <coroutine>
 #include <exception>
-#include <iostream>
-#include <map>
-#include <optional>
+#include <limits>
+#include <mutex>
+#include <initializer_list>
+#include <new>
+#include <ostream>
+#include <source_location>
+#include <span>
 #include <string>
 #include <type_traits>
-#include <vector>
-#include <unistd.h>
+#include <utility>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// With ZEST_SPLIT, this is only the interface, and the runner is built
+// in the one file that defines ZEST_IMPLEMENTATION.
+#if defined(ZEST_IMPLEMENTATION) && !defined(ZEST_SPLIT)
+#define ZEST_SPLIT
+#endif
+#ifdef ZEST_SPLIT
+#define ZEST_DEF
+#else
+#define ZEST_DEF inline
+#endif
 
 namespace zest
 {
 
-#define ZOUT(x) do{ std::cout << x << std::flush; }while(0)
-#define ZPRN(x) do{ std::cout << x << std::endl; }while(0)
+#define ZOUT(x) do{ zest::out() << x; }while(0)
+#define ZPRN(x) do{ zest::out() << x << "\n"; }while(0)
 #define ZLOG(x) ZPRN(#x " = " << (x))
 
-static inline const char *cRED, *cGRN, *cDIM, *cOFF=0;
-inline bool autocolor() {
-  return isatty(fileno(stdout)) && !getenv("NO_COLOR") &&
-    (getenv("TERM") && (getenv("TERM") != std::string_view("dumb")));
-}
-inline void color(bool enabled) {
-  cRED = !enabled ? "" : "\033[31m";
-  cGRN = !enabled ? "" : "\033[32m";
-  cDIM = !enabled ? "" : "\033[38;5;8m";
-  cOFF = !enabled ? "" : "\033[m";
-}
+bool autocolor();
+void color(bool enabled);
 
 template <class T>
 concept Printable = requires(std::ostream& os, T x) { os << x; };
 
-template <Printable T>
-std::ostream& operator<<(std::ostream& os, std::optional<T> opt)
+// std::optional and the like, without <optional>.
+template <class T>
+concept Optional = requires(const T& x) { x.has_value(); x.value_or(*x); }
+  && Printable<typename T::value_type>;
+
+template <Optional T>
+std::ostream& operator<<(std::ostream& os, const T& opt)
 { if (opt){ os << *opt; } else { os << "(none)"; } return os; }
 
 inline std::ostream& operator<<(std::ostream& os, const std::exception& e)
@@ -207,107 +544,368 @@ using Str = std::string;
 using Run = void();
 
 
-struct TestCase {
-  Run* run;
-  Str title;
-  Str file;
+struct TestCase;
+
+// The machinery behind the public names, kept out of the way of the
+// unqualified names in TEST bodies, which are looked up in zest first.
+namespace detail {
+
+struct Console;
+struct Stream;
+struct Sink;
+
+// A locked handle to an output stream. Whatever is streamed into one
+// Out comes out whole, even when several threads share a test. An Out
+// from fail() collects the message and reports it when it goes away.
+struct Out {
+  std::unique_lock<std::recursive_mutex> lock;
+  std::ostream& os;
+  TestCase* failing;
+  std::string_view file;
   int line;
-  int failed = 0;
-  bool done = false;
 
-  std::ostream& output() {
-    if (!done && (failed == 1)) ZPRN(cRED << " ✗ " << title << cOFF);
-    else if (done && (!failed)) ZPRN(cGRN << " ✓ " << title << cOFF);
-    return std::cout;
-  }
+  Out(std::unique_lock<std::recursive_mutex> lk, std::ostream& os,
+      TestCase* t=nullptr, std::string_view f={}, int l=0)
+    : lock(std::move(lk)), os(os), failing(t), file(f), line(l) {}
+  Out(Out&& o) : lock(std::move(o.lock)), os(o.os),
+    failing(std::exchange(o.failing, nullptr)), file(o.file), line(o.line) {}
+  ~Out();
+
+  template <class T> Out& operator<<(const T& x) { os << x; return *this; }
+  Out& operator<<(std::ostream& (*f)(std::ostream&)) { os << f; return *this; }
+};
 
-  inline std::ostream& fail(const Str& file, int line)  {
-    ++failed;
-    return output() << file << ":" << line << ": " << "FAIL: ";
+// The objects made by zest::shared() for one group, destroyed in
+// reverse order once its last test has finished.
+struct Shared {
+  struct Obj { const void* tag; void* p; void (*drop)(void*); Obj* next; };
+  std::recursive_mutex mtx;
+  Obj* objs = nullptr;  // newest first
+  template <class T> static inline const char tag = 0;
+  ~Shared() {
+    while (auto o = objs) { objs = o->next; o->drop(o->p); delete o; }
   }
+};
+
+// Hardware counters of the calling thread, from perf_event_open(2).
+// Events the kernel refuses read as -1; without a cycle counter
+// nothing is counted, and `ok` stays false.
+struct Perf {
+  enum { CYCLES, INSNS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, N };
+  double count[N] = {};
+  double ops = 1;  // operations the counts cover
+  bool ok = false;
+  int fd[N] = {-1, -1, -1, -1, -1};
+  static inline std::atomic<bool> warned = false;
+
+  void start();
+
+  // Reads the counts, scaled up if the kernel had to multiplex them.
+  void stop();
+
+  void close();
+  ~Perf() { close(); }
+};
+
+std::ostream& stdout_stream();  // std::cout
+
+struct Failure { Str file; int line; Str message; };
+
+} // namespace detail
+
+struct TestCase {
+  Run* run = nullptr;
+  const char* group = "";
+  const char* title = "";
+  const char* file = "";
+  int line = 0;
+  std::atomic<int> failed = 0;
+  std::atomic<bool> done = false;
+  double wall = 0, cpu = 0;  // seconds spent in before/body/after
+  double timeout = 0;  // seconds / 0 = the run's default (.timeout)
+  std::ostream* out = &detail::stdout_stream();
+  detail::Shared* shared = nullptr;  // the group's
+  detail::Perf perf;  // of body(), with .counters
+  Str failures;  // kept for .jsonl and .junit; see detail::pack()
+  std::recursive_mutex mtx;
+
+  detail::Out output() { return {std::unique_lock(mtx), *out}; }
+
+  // Locks the test and returns a stream for one failure message.
+  detail::Out fail(std::string_view file, int line);
 
-  inline std::ostream& fail(const Str& msg = "") {
-    return fail(file,line) << msg << (msg.empty() ? "" : "\n");
+  inline detail::Out fail(const Str& msg = "") {
+    auto o = fail(file,line); o << msg << (msg.empty() ? "" : "\n");
+    return o;
   }
 
   inline virtual void before() {}
+  inline virtual void body() { run(); }
   inline virtual void after() {}
+  inline virtual void details(std::ostream&) const {}  // after ✓ title
+  inline virtual Str pack() const { return ""; }  // kept in its Result
   virtual ~TestCase() {}
+
+  static constexpr bool persist = false;  // see zest::detail::Fixture
+  static constexpr bool cache = true;  // a pass may be kept in .cache
 };
 
-class Test { public: template <class T> static void run(); };
-struct Flag { static inline TestCase skip, only; };
+namespace detail {
 
-struct Runner {
-  static inline std::map<Str, std::vector<TestCase*>> groups;
-  static inline TestCase* current = nullptr;
-  static inline bool only_mode = false;
+// One registered test. ZEST_TEST builds these at compile time and
+// links them into Runner::entries, to be grouped when run() is called.
+struct Entry {
+  const char* group;
+  const char* title;
+  const char* file;
+  int line;
+  Run* run;
+  TestCase* test = nullptr;  // or built by make() and freed by drop()
+  TestCase* (*make)() = nullptr;
+  void (*drop)(TestCase*) = nullptr;
+  bool cache = true;  // TestCase::cache of its fixture
+  Entry* next = nullptr;
+};
 
-  static bool add(TestCase& c, Str g, Str t, Run* r, Str f, int l) {
-    c.run=r; c.title=t; c.file=f; c.line=l;
-    groups[g].push_back(&c);
-    return true;
+// Builds the fixture of a ZEST_TEST when the test is about to run, and
+// frees it after after(). A TestCase subclass that declares
+// `static constexpr bool persist = true;` is built once for each test
+// T and kept, so tests of other groups never share it.
+template <class C, class T>
+struct Fixture {
+  static TestCase* make() {
+    if constexpr (C::persist) { static C c; return &c; }
+    else { return new C(); }
   }
+  static void drop(TestCase* t) { if constexpr (!C::persist) delete t; }
+};
 
-  static void skip(Str group) {
-    auto& g = groups[group];
-    g.insert(g.begin(), &Flag::skip);
-  }
+// How one test of a run went, kept after its fixture is gone.
+struct Result {
+  const Entry* entry;
+  const char* group;
+  const char* title;
+  const char* file;
+  int line;
+  int failed = 0;
+  bool done = false;
+  double wall = 0, cpu = 0;
+  Str packed = {};  // TestCase::pack()
+  Str failures = {};  // with .jsonl or .junit; see detail::pack()
+};
 
-  static void only(Str group) {
-    auto& g = groups[group];
-    g.insert(g.begin(), &Flag::only);
-    only_mode = true;
-  }
+struct Shard { int index = 0, count = 0; };  // index is 1..count
 
-  static inline int run() {
-    int nfail=0, nskip=0;
-    if (!cOFF) { color(autocolor()); }
-    for (auto& [group, tests] : groups) {
-      if ((tests[0] == &Flag::skip) ||
-          ((tests[0] != &Flag::only) && only_mode)) {
-        nskip += tests.size() - 1;
-        continue;
-      }
-      ZPRN("\n[" << group << "]");
-      for (auto t : tests) {
-        if (!t->run) { continue; }
-        current = t;
-        t->before();
-        try {
-          t->run();
-        } catch (...) {
-          t->fail("Uncaught exception");
-          std::rethrow_exception(std::current_exception());
-        }
-        t->after();
-        t->done = true;
-        t->output();
-        nfail += t->failed ? 1 : 0;
-        current = nullptr;
-      }
-    }
-    auto C = nfail ? cRED : cGRN;
-    printf("%s\n┌──────┐", C);
-    printf("%s\n│ %-4s │", C, (nfail ? "FAIL" : " OK "));
-    if (nskip) printf("%s (%d skipped)", cDIM, nskip);
-    printf("%s\n└──────┘", C);
-    printf("%s\n", cOFF);
-    return nfail ? 1 : 0;
-  }
+} // namespace detail
+
+struct Summary {
+  int nfail=0, nskip=0;
+  std::span<const detail::Result* const> tests;  // every test that ran
+  detail::Shard shard = {};
+  int nstop = 0;  // tests left unrun by .max_failures
+  int ncached = 0;  // tests that passed before, per .cache
+};
+
+// Receives the events of a run. Hooks for different groups may be
+// called from several workers at once; one group's hooks never are.
+// Each test writes to its own stream, t.out. With .isolate, all hooks
+// run in the parent, and a test's get a stand-in for its fixture.
+struct Reporter {
+  virtual void on_group_start(const Str& /*group*/, std::ostream& /*out*/) {}
+  virtual void on_test_start(TestCase& /*t*/) {}
+  virtual void on_failure(TestCase& /*t*/, std::string_view /*file*/,
+                          int /*line*/, std::string_view /*msg*/) {}
+  virtual void on_test_end(TestCase& /*t*/) {}
+  virtual void on_group_end(const Str& /*group*/, std::ostream& /*out*/) {}
+  virtual void on_summary(const Summary& /*s*/, std::ostream& /*out*/) {}
+  virtual ~Reporter() {}
+};
+
+namespace async { struct Task; }
+class Test {
+  public:
+    template <class T> static void run();
+    template <class T> static async::Task task();  // body of an ASYNC_TEST
+};
+
+namespace detail {
+
+// Selects tests by a GROUP[/TITLE] pattern. The halves are globs, or
+// regexes searched for in the names; a missing TITLE matches any.
+struct Filter {
+  bool exclude = false;  // drop matching tests instead
+  Str group, title;
+  struct Regex;
+  const Regex* re = nullptr;  // with regex, kept for good
+
+  Filter(std::string_view pat, bool regex=false, bool exclude=false);
+  Filter(const char* pat) : Filter(std::string_view(pat)) {}
+
+  bool match(const char* g, const char* t) const;
+};
+
+// The patterns of Options::filter. They are kept for good, and copies
+// share them.
+struct Filters {
+  struct List;
+  const List* list = nullptr;
+
+  Filters() = default;
+  Filters(std::initializer_list<Filter> fs);
+
+  void add(Filter f);  // to this copy only
+
+  // Matched by an included pattern, if any, and by no excluded one.
+  bool wanted(const char* g, const char* t) const;
+};
+
+} // namespace detail
+
+struct Options {
+  int jobs = 0;  // worker threads / 0 = $ZEST_JOBS or 1 / -1 = per core
+  bool isolate = false;  // use forked worker processes / or $ZEST_ISOLATE
+  Reporter* reporter = nullptr;  // default: the console
+  bool times = true;   // show each test's wall time
+  int slowest = 0;     // list the N slowest tests / or $ZEST_SLOWEST
+  double timeout = 0;  // default seconds per test / or $ZEST_TIMEOUT
+  detail::Shard shard = {};  // run one shard of the tests / or $ZEST_SHARD=i/n
+  bool shard_by_time = false;  // balance shards using .history
+  const char* history = nullptr;  // per-test results / or $ZEST_HISTORY
+  bool failed_first = false;  // order by .history / or $ZEST_FAILED_FIRST
+  double bench_time = 0.5;  // seconds spent measuring each BENCH
+  int bench_reps = 10;      // samples per BENCH
+  int bench_warmup = 2;     // samples run and thrown away first
+  const char* baseline = nullptr;  // file of BENCH results / or $ZEST_BASELINE
+  bool update_baseline = false;    // rewrite it / or $ZEST_UPDATE_BASELINE
+  double bench_threshold = 0.10;   // fail benches this much slower
+  double bench_max_cv = 0.10;  // benches noisier than this are unreliable
+  int bench_cpu = -1;  // pin benches to this CPU / or $ZEST_BENCH_CPU
+  int max_failures = 0;  // stop after N failed tests / or $ZEST_MAX_FAILURES
+  bool counters = false;  // cycles, IPC and misses / or $ZEST_COUNTERS
+  int async_jobs = 16;  // ASYNC_TESTs of a group that run at once
+  detail::Filters filter = {};  // run only what these select
+  bool list = false;  // print the selected tests instead of running them
+  const char* jsonl = nullptr;  // stream JSON Lines here / or $ZEST_JSONL
+  const char* junit = nullptr;  // stream JUnit XML here / or $ZEST_JUNIT
+  const char* profile = nullptr;  // folded stacks per test / or $ZEST_PROFILE
+  const char* cache = nullptr;  // skip tests that passed / or $ZEST_CACHE
 };
 
+struct Runner {
+  using Entry = detail::Entry;
+  using Result = detail::Result;
+  using Failure = detail::Failure;
+  using Shared = detail::Shared;
+  using Filter = detail::Filter;
+  using Shard = detail::Shard;
+  using Stream = detail::Stream;
+  using Console = detail::Console;
+  using Sink = detail::Sink;
+
+  static inline Entry* entries = nullptr;  // newest first
+  struct Groups;  // of names
+  static Groups skipped, onlies;
+  static inline std::atomic<int> failures = 0;
+  static inline std::atomic<bool> stopped = false;  // by .max_failures
+  static inline thread_local TestCase* current = nullptr;
+  // Where zest::out() writes between the tests of a group, e.g. from
+  // the destructors of zest::shared() objects.
+  static inline thread_local std::ostream* group_out = nullptr;
+  static inline bool isolated = false;  // inside a forked worker
+  static inline Stream* stream = nullptr;  // with .jsonl or .junit
+  static inline bool threaded = false;  // running on a thread pool
+  static inline Options opt;
+  static Console console;
+  static Reporter* reporter;  // .reporter, or &console
+  static Sink buffer;
+  static std::ostream sink;
+
+  static bool add(Entry& e);
+
+  // For tests registered at run time; the strings are kept for good.
+  static bool add(TestCase& c, Str g, Str t, Run* r, Str f, int l);
+
+  static void skip(Str group);
+  static void only(Str group);
+
+  struct clock;  // std::chrono::steady_clock
+
+  static double limit(const TestCase* t);
+
+  struct Watchdog;  // ends the run when a test overruns its timeout
+  static Watchdog& watchdog();
+
+  static double cpu_now(bool shared);
+
+  // Counts a failed test, and stops the run once there are enough.
+  static void tally(const Result& r);
+
+  static TestCase* make(const Result& r, Shared& s);
+
+  static void run_test(Result& r, TestCase* t, std::ostream& out);
+
+  static void end_test(Result& r, TestCase* t, double wall, double cpu);
+
+  struct Tests;  // of one group, in order
+  struct Todo;  // group names and their Tests
+
+  static int run_group(const Str& group, Tests& tests, std::ostream& out);
+  static size_t run_async(Tests& tests, size_t i, TestCase*& t,
+                          Shared& shared, std::ostream& out);
+
+  // Each group is buffered while it runs, and finished groups are
+  // printed in order, so the output matches a serial run.
+  static int run_parallel(Todo& todo, int jobs);
+
+  enum Kind { START, LIMIT, END, TEARDOWN, DONE };
+  struct Msg;
+
+  static bool read_all(int fd, void* p, size_t n);
+
+  static void write_all(int fd, const void* p, size_t n);
+
+  static void send(int fd, Msg m, Str s="", const Str& packed="",
+                   const Str& notes="", const Str& details="");
+
+  // A worker process reads (group, first test) tasks from `rx` and
+  // reports each test on `tx` as it starts and ends.
+  [[noreturn]] static void work(Todo& todo, int rx, int tx);
+
+  // Runs groups in forked workers. When a worker dies, the test it was
+  // running fails, and the rest of its group goes to a fresh worker.
+  static int run_isolated(Todo& todo, int jobs);
+
+  // FNV-1a, mixed by the splitmix64 finalizer so that every bit, and
+  // so the hash modulo any count, depends on every byte.
+  static uint64_t hash(std::string_view s);
+
+  // Moves groups with a test that failed last time to the front,
+  // followed by groups with tests the history has never seen.
+  static void failed_first(Todo& todo);
+
+  // Keeps the tests of one shard. A test's shard is a hash of its group
+  // and title, or with shard_by_time, tests with a recorded duration
+  // are dealt longest first to the least loaded shard.
+  static void shard(Todo& todo, Shard sh);
+
+  static const char* profiling();
+
+  static int jobs(const Options& opt);
+
+  static int run(const Options& opt = {});
+};
 
 #define ZEST_IS_FN(NAME, COMP)                                         \
   template <class LHS, class RHS>                                      \
-  bool is_##NAME##_(Str f, size_t l,                                   \
-                    Str lhs_str, const LHS& lhs,                       \
-                    Str rhs_str, const RHS& rhs) {                     \
+  bool is_##NAME##_(std::source_location loc,                          \
+                    const char* lhs_str, const LHS& lhs,               \
+                    const char* rhs_str, const RHS& rhs) {             \
     TestCase* t = Runner::current;                                     \
     if (!t) { throw "Called is_" #NAME " while no current test"; }     \
     if (t->done) { throw "Called is_" #NAME " in finished test"; }     \
     if ((rhs COMP lhs)) { return true; }                               \
-    auto& out = t->fail(f,l) << rhs_str << " " #COMP " " << lhs_str;   \
+    auto out = t->fail(loc.file_name(), loc.line());                   \
+    out << rhs_str << " " #COMP " " << lhs_str;                        \
     if constexpr (Printable<LHS> && Printable<RHS>)                    \
       out << "  (" << rhs << " " #COMP " " << lhs << ")";              \
     out << "\n"; return false; }                                       \
@@ -319,53 +917,2636 @@ ZEST_IS_FN(lt, <)
 ZEST_IS_FN(ge, >=)
 ZEST_IS_FN(le, <=)
 
+// Compares ranges element by element, or with memcmp when both are
+// contiguous arrays of one type whose bytes are its value. A failure
+// counts the differing elements and shows a few around the first one.
+template <class E, class A, class Show>
+bool is_eq_range_(std::source_location loc, const char* e_str, const E& e,
+                  const char* a_str, const A& a, Show&& show) {
+  using TE = std::ranges::range_value_t<E>;
+  using TA = std::ranges::range_value_t<A>;
+  TestCase* t = Runner::current;
+  if (!t) { throw "Called is_eq_range while no current test"; }
+  if (t->done) { throw "Called is_eq_range in finished test"; }
+  size_t ne = std::ranges::distance(e), na = std::ranges::distance(a);
+  if constexpr (std::ranges::contiguous_range<E> &&
+                std::ranges::contiguous_range<A> && std::is_same_v<TE, TA> &&
+                std::has_unique_object_representations_v<TE>) {
+    if ((ne == na) && (!ne || !memcmp(std::ranges::data(e),
+                                      std::ranges::data(a), ne * sizeof(TE))))
+      return true;
+  }
+  size_t n = std::min(ne, na), ndiff = 0, first = n;
+  auto ie = std::ranges::begin(e);
+  auto ia = std::ranges::begin(a);
+  for (size_t i = 0; i < n; ++i, ++ie, ++ia) {
+    if (*ia == *ie) { continue; }
+    if (!ndiff++) { first = i; }
+  }
+  if (!ndiff && (ne == na)) { return true; }
+  auto out = t->fail(loc.file_name(), loc.line());
+  out << a_str << " == " << e_str << "  (";
+  if (ne != na) { out << "size " << na << " != " << ne << ", "; }
+  out << ndiff << " of " << n << " differ";
+  if (ndiff) { out << ", first at [" << first << "]"; }
+  out << ")\n";
+  size_t lo = (first > 2) ? first - 2 : 0, hi = std::min(n, first + 3);
+  ie = std::ranges::next(std::ranges::begin(e), lo);
+  ia = std::ranges::next(std::ranges::begin(a), lo);
+  for (size_t i = lo; i < hi; ++i, ++ie, ++ia) {
+    out << ((*ia == *ie) ? "    [" : "  ✗ [") << i << "] ";
+    show(out, *ia); out << " == "; show(out, *ie); out << "\n";
+  }
+  return false;
+}
+
+namespace detail {
+
+// Tolerances of is_near_all. An element passes when it is within any
+// one of them of the expected value; two NaNs count as equal.
+struct Near { double abs = 0, rel = 0; uint64_t ulps = 0; };
+
+// The distance between two floats in units in the last place. The
+// bits are flipped so that unsigned order matches the values' order,
+// keeping to one integer width so the loop below can be vectorized.
+template <class F, class U = std::conditional_t<sizeof(F) == 4, uint32_t,
+                                                uint64_t>>
+inline U ulps(F x, F y) {
+  U i, j;
+  memcpy(&i, &x, sizeof i); memcpy(&j, &y, sizeof j);
+  constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+  i = (i & sign) ? ~i : (i | sign);
+  j = (j & sign) ? ~j : (j | sign);
+  return (i > j) ? i - j : j - i;
+}
+
+} // namespace detail
+
+// Counts the elements out of tolerance in one branch-free pass, and
+// only on failure goes back for the worst one and the maxima.
+template <class E, class A>
+bool is_near_all_(std::source_location loc, const char* e_str, const E& e,
+                  const char* a_str, const A& a, detail::Near tol) {
+  using F = std::ranges::range_value_t<E>;
+  static_assert(std::is_floating_point_v<F>, "is_near_all takes floats");
+  static_assert(std::is_same_v<F, std::ranges::range_value_t<A>>);
+  TestCase* t = Runner::current;
+  if (!t) { throw "Called is_near_all while no current test"; }
+  if (t->done) { throw "Called is_near_all in finished test"; }
+  std::span<const F> xs(std::ranges::data(a), std::ranges::size(a));
+  std::span<const F> ys(std::ranges::data(e), std::ranges::size(e));
+  size_t n = std::min(xs.size(), ys.size()), nbad = 0;
+  using detail::ulps;
+  using U = decltype(ulps(F(), F()));
+  F abs = tol.abs, rel = tol.rel;
+  U ul = std::min<uint64_t>(tol.ulps, std::numeric_limits<U>::max());
+  auto near = [&](size_t i) {
+    F x = xs[i], y = ys[i], d = std::fabs(x - y);
+    return ((x != x) & (y != y)) | (d <= abs) | (d <= rel * std::fabs(y)) |
+           (ulps(x, y) <= ul);
+  };
+  for (size_t i = 0; i < n; ++i) { nbad += !near(i); }
+  if (!nbad && (xs.size() == ys.size())) { return true; }
+  auto out = t->fail(loc.file_name(), loc.line());
+  out << a_str << " ≈ " << e_str << "  (";
+  if (xs.size() != ys.size())
+    out << "size " << xs.size() << " != " << ys.size() << ", ";
+  out << nbad << " of " << n << " out of tolerance)\n";
+  size_t worst = n;
+  U worst_ulps = 0, max_ulps = 0;
+  double max_abs = 0;
+  for (size_t i = 0; i < n; ++i) {
+    auto u = ulps(xs[i], ys[i]);
+    max_abs = std::fmax(max_abs, std::fabs((double)xs[i] - ys[i]));
+    max_ulps = std::max(max_ulps, u);
+    if (!near(i) && ((worst == n) || (u > worst_ulps)))
+      { worst = i; worst_ulps = u; }
+  }
+  char buf[160];
+  int digits = std::numeric_limits<F>::max_digits10;
+  if (worst < n) {
+    double x = xs[worst], y = ys[worst], d = std::fabs(x - y);
+    snprintf(buf, sizeof buf, "    worst [%zu]: %.*g vs %.*g  (abs %.3g,"
+             " rel %.3g, %llu ulps)\n", worst, digits, x, digits, y, d,
+             d / std::fabs(y), (unsigned long long)worst_ulps);
+    out << buf;
+  }
+  snprintf(buf, sizeof buf, "    max of all: abs %.3g, %llu ulps\n",
+           max_abs, (unsigned long long)max_ulps);
+  out << buf;
+  return false;
+}
+
+template <class E, class A>
+bool is_eq_range_(std::source_location loc, const char* e_str, const E& e,
+                  const char* a_str, const A& a) {
+  return is_eq_range_(loc, e_str, e, a_str, a, [](auto& out, auto& x) {
+    if constexpr (Printable<decltype(x)>) { out << x; } else { out << "?"; }
+  });
+}
+
+inline bool is_eq_bytes_(std::source_location loc, const char* e_str,
+                         const void* e, const char* a_str, const void* a,
+                         size_t n) {
+  std::span be((const unsigned char*)e, n), ba((const unsigned char*)a, n);
+  return is_eq_range_(loc, e_str, be, a_str, ba, [](auto& out, auto x) {
+    char buf[8]; snprintf(buf, sizeof buf, "0x%02x", x); out << buf;
+  });
+}
+
 template <class E, class F>
-bool is_thrown_(Str f, size_t l, Str e, F&& body) {
+bool is_thrown_(std::source_location loc, const char* e, F&& body) {
   TestCase* t = Runner::current;
   if (!t) { throw "Called is_thrown while no current test"; }
+  auto f = loc.file_name(); auto l = loc.line();
   int n = 0;
-  try { body(); } catch (E) {++n;} catch(...) { t->fail(f, l)
-    << "Error thrown was not a " << e << std::endl; ++n; }
-  if (n == 0) { t->fail(f, l) << "Nothing thrown" << std::endl; }
+  try { body(); } catch (const E&) {++n;} catch(...) { t->fail(f, l)
+    << "Error thrown was not a " << e << "\n"; ++n; }
+  if (n == 0) { t->fail(f, l) << "Nothing thrown\n"; }
   return n != 0;
 }
 
+namespace detail {
 
-#define ZEST_FULLNAME_(pre, grp, uniq) pre##_##grp##_##uniq
-#define ZEST_FULLNAME(pre, grp, uniq) ZEST_FULLNAME_(pre, grp, uniq)
+// What operator new has handed out on this thread, counted once some
+// file defines ZEST_COUNT_ALLOCS.
+struct Allocs {
+  static inline thread_local size_t count = 0, bytes = 0;
+  static inline bool on = false;
+};
 
-#define ZEST_CLS(grp) ZEST_FULLNAME(_testcls, grp, __LINE__)
-#define ZEST_FUN(grp) zest::Test::run<ZEST_CLS(grp)>
+} // namespace detail
 
-#define ZEST_TEST(C, g, t)                                             \
-  struct ZEST_CLS(g) {static inline C c; static bool b;};              \
-  template <> void ZEST_FUN(g)();                                      \
-  bool ZEST_CLS(g)::b = zest::Runner::add(                             \
-    ZEST_CLS(g)::c, #g, t, ZEST_FUN(g), __FILE__, __LINE__);           \
-  template <> void ZEST_FUN(g)()
+template <class F>
+bool is_allocs_(std::source_location loc, bool bytes, size_t max,
+                const char* body_str, F&& body) {
+  TestCase* t = Runner::current;
+  auto name = bytes ? "is_bytes_le" : "is_allocs_le";
+  if (!t) { throw "Called is_allocs_le/is_bytes_le while no current test"; }
+  auto f = loc.file_name(); auto l = loc.line();
+  using detail::Allocs;
+  if (!Allocs::on) {
+    t->fail(f, l) << name << " needs #define ZEST_COUNT_ALLOCS"
+                  << " before one #include \"zest.hh\"\n";
+    return false;
+  }
+  size_t n = Allocs::count, b = Allocs::bytes;
+  body();
+  n = Allocs::count - n; b = Allocs::bytes - b;
+  if ((bytes ? b : n) <= max) { return true; }
+  t->fail(f, l) << body_str << ": " << n << " allocations, " << b
+                << " bytes (" << name << " " << max << ")\n";
+  return false;
+}
 
 
-static auto& run = Runner::run;
-static auto& skip = Runner::skip;
-static auto& only = Runner::only;
+template <class T>
+inline void do_not_optimize(const T& x) { asm volatile("" : : "r,m"(x) : "memory"); }
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
 
-template <class T = TestCase>
-static inline T& current() {
-  if (!Runner::current)
-    throw "Called zest::current() while no current test";
-  return dynamic_cast<T&>(*Runner::current);
-}
+namespace detail {
 
-#define TEST(Group, Title) ZEST_TEST(zest::TestCase, Group, Title)
-#define is_eq(e,a) zest::is_eq_(__FILE__,__LINE__, #e,(e), #a,(a))
-#define is_ne(e,a) zest::is_ne_(__FILE__,__LINE__, #e,(e), #a,(a))
-#define is_gt(e,a) zest::is_gt_(__FILE__,__LINE__, #e,(e), #a,(a))
-#define is_lt(e,a) zest::is_lt_(__FILE__,__LINE__, #e,(e), #a,(a))
-#define is_ge(e,a) zest::is_ge_(__FILE__,__LINE__, #e,(e), #a,(a))
-#define is_le(e,a) zest::is_le_(__FILE__,__LINE__, #e,(e), #a,(a))
+// A TestCase whose body is one operation. The number of iterations
+// per sample is doubled until a sample fills its share of bench_time.
+struct Bench : TestCase {
+  static constexpr bool cache = false;  // its numbers are the point
+  size_t iters = 0;             // iterations per sample
+  int reps = 0;                 // samples measured
+  double ns = 0, mad = 0;       // median ns/op, median absolute deviation
+  double base = 0;              // ns/op in the baseline file
+  double cv = 0;                // robust coefficient of variation
 
-#define is_thrown(E, body) \
-  zest::is_thrown_<E>(__FILE__,__LINE__, #E, [&]() mutable { body; })
+  struct Mark { double ns, mad; int reps; };
 
-} // namespace zest
+  double sample(size_t n);
+
+  void body() override;
+
+  // Too noisy to compare, or to keep in the baseline.
+  bool unreliable() const;
+
+  // Sets ns and mad from samples filling about `seconds` in all.
+  void measure(double seconds);
+
+  // Fails when the median is more than bench_threshold slower than the
+  // baseline, and the gap is over 3 standard errors of both medians.
+  void compare();
+
+  void details(std::ostream& os) const override;
+
+  Str pack() const override;
+
+  static void load(const char* path);
+
+  // Records benches that are new or, with update_baseline, all of them.
+  static void save(const char* path, std::span<const Result* const> ran);
+};
+
+// Durations in ns, counted in buckets 1/32 of a power of two wide, so
+// each is known to within about 3% in 15 KB.
+struct Histogram {
+  static constexpr int SUB = 5;
+  uint64_t counts[(65 - SUB) << SUB] = {};
+  uint64_t n = 0, max = 0;
+
+  static int index(uint64_t v) {
+    if (v < (1u << SUB)) { return v; }
+    int shift = 63 - __builtin_clzll(v) - SUB;
+    return ((shift + 1) << SUB) | ((v >> shift) & ((1u << SUB) - 1));
+  }
+
+  static uint64_t top(int i) {  // the largest value in bucket i
+    if (i < (1 << SUB)) { return i; }
+    int shift = (i >> SUB) - 1;
+    uint64_t m = (i & ((1u << SUB) - 1)) | (1u << SUB);
+    return ((m + 1) << shift) - 1;
+  }
+
+  void record(uint64_t ns) { ++counts[index(ns)]; ++n; max = std::max(max, ns); }
+
+  double at(double q) const {  // ns at quantile q
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(q * n)), seen = 0;
+    for (size_t i = 0; i < std::size(counts); ++i)
+      if ((seen += counts[i]) >= rank) { return std::min(top(i), max); }
+    return max;
+  }
+
+  static Str show(double ns);
+
+  Str summary() const;
+};
+
+// A BENCH that times every call of its body; see LATENCY_BENCH. It
+// reports percentiles, and has no baseline.
+struct Latency : Bench {
+  Histogram hist;
+  void body() override;
+  void details(std::ostream& os) const override;
+};
+
+// The growth classes a SCALING_BENCH is fitted to, in order.
+enum class Big { O_auto, O_1, O_log_n, O_n, O_n_log_n, O_n2 };
+
+// A BENCH whose body is run at sizes n = lo, 2·lo, 4·lo .. hi, which it
+// reads with zest::bench_size(). The ns/op are fitted to c·f(n) for each Big
+// by least squares on their logs; the class with the least error wins.
+// With an expected class, it fails when a faster growing class fits
+// at least twice as well.
+struct Scaling : Bench {
+  using enum Big;
+  size_t n = 0, lo = 0, hi = 0;
+  Big expect = O_auto, big = O_auto;
+  double coef = 0, rms = 0;
+  std::pair<size_t, double> measured[64];  // n, ns/op
+  int npoints = 0;
+  std::span<const std::pair<size_t, double>> points() const
+  { return {measured, size_t(npoints)}; }
+
+  static const char* name(Big b);
+
+  static double f(Big b, double n);
+
+  // c and the RMS error of log(c·f(n)/t). Fitting the logs weighs
+  // every size the same, not just the largest.
+  std::pair<double, double> fit(Big b) const;
+
+  void body() override;
+
+  void details(std::ostream& os) const override;
+
+  Str pack() const override;
+};
+
+template <size_t Lo, size_t Hi, Big B>
+struct Scaled : Scaling {
+  Scaled() { lo = Lo; hi = Hi; expect = B; }
+};
+
+// A std::chrono::duration, or a number of seconds, in seconds.
+template <class D>
+double seconds(D d) {
+  if constexpr (requires { d.count(); D::period::den; })
+    return double(d.count()) * D::period::num / D::period::den;
+  else return d;
+}
+
+// is_quantile_le_ with the body called through a function pointer.
+bool quantile_le(std::source_location loc, double q, const char* name,
+                 double max, const char* body_str, void (*body)(void*),
+                 void* ctx);
+
+} // namespace detail
+
+template <class D, class F>
+bool is_quantile_le_(std::source_location loc, double q, const char* name,
+                     D max, const char* body_str, F&& body) {
+  auto call = [](void* f) { (*static_cast<std::remove_reference_t<F>*>(f))(); };
+  return detail::quantile_le(loc, q, name, detail::seconds(max), body_str,
+                             call, &body);
+}
+
+namespace detail {
+
+struct Loop;
+
+void wake(Loop& l);  // runs the loop on when a test's body is done
+
+// Resumes h on the current async test's loop after `s` seconds.
+void resume_after(double s, std::coroutine_handle<> h);
+
+// Resumes h on the current async test's loop once done(p), which the
+// loop polls between resuming others.
+void resume_when(bool (*done)(void*), void* p, std::coroutine_handle<> h);
+
+} // namespace detail
+
+// Coroutine tasks and the awaitables of async tests, out of the way of
+// the unqualified names in TEST bodies, which are looked up in zest.
+namespace async {
+
+// The coroutine type of ASYNC_TEST bodies and the helpers they await.
+// Every co_await in one restores Runner::current when it resumes, so
+// assertions count against the right test whichever thread resumes it.
+struct Task {
+  struct promise_type {
+    TestCase* test = nullptr;  // of a test's body
+    detail::Loop* loop = nullptr;  // of a test's body, woken at its end
+    std::coroutine_handle<> next = nullptr;  // of a helper: its caller
+    std::exception_ptr err;
+    std::atomic<bool> finished = false;
+
+    Task get_return_object()
+    { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+    auto initial_suspend() noexcept {
+      struct Start : std::suspend_always {
+        promise_type& p;
+        void await_resume() noexcept { if (p.test) Runner::current = p.test; }
+      };
+      return Start{{}, *this};
+    }
+    auto final_suspend() noexcept {
+      struct End : std::suspend_always {
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+          auto& p = h.promise();
+          auto next = p.next;
+          auto loop = p.loop;
+          p.finished = true;
+          if (next) { return next; }
+          if (loop) { detail::wake(*loop); }
+          return std::noop_coroutine();
+        }
+      };
+      return End{};
+    }
+    void return_void() {}
+    void unhandled_exception() { err = std::current_exception(); }
+
+    template <class A>
+    static decltype(auto) awaiter(A&& a) {
+      if constexpr (requires { std::forward<A>(a).operator co_await(); })
+        return std::forward<A>(a).operator co_await();
+      else return std::forward<A>(a);
+    }
+
+    template <class W>
+    struct Reenter {
+      W w;
+      TestCase* t;
+      bool await_ready() { return w.await_ready(); }
+      template <class H> auto await_suspend(H h) { return w.await_suspend(h); }
+      decltype(auto) await_resume() {
+        Runner::current = t;
+        return w.await_resume();
+      }
+    };
+
+    template <class A>
+    auto await_transform(A&& a) {
+      using W = decltype(awaiter(std::forward<A>(a)));
+      return Reenter<W>{awaiter(std::forward<A>(a)), Runner::current};
+    }
+  };
+
+  std::coroutine_handle<promise_type> h = nullptr;
+
+  Task() = default;
+  Task(std::coroutine_handle<promise_type> h) : h(h) {}
+  Task(Task&& o) : h(std::exchange(o.h, nullptr)) {}
+  Task& operator=(Task&& o) { std::swap(h, o.h); return *this; }
+  ~Task() { if (h) h.destroy(); }
+
+  bool done() const { return !h || h.promise().finished; }
+
+  // Awaiting a Task runs it, and resumes the caller when it ends.
+  bool await_ready() { return done(); }
+  auto await_suspend(std::coroutine_handle<> caller) {
+    h.promise().next = caller;
+    return h;
+  }
+  void await_resume() {
+    if (h.promise().err) std::rethrow_exception(h.promise().err);
+  }
+};
+
+} // namespace async
+
+// A TestCase whose body is a coroutine; see ASYNC_TEST. While one
+// awaits, the other async tests of its group get to run.
+struct Async : TestCase {
+  async::Task task;  // set by run()
+  detail::Loop* loop = nullptr;
+
+  void start(detail::Loop& l);
+
+  void post(std::coroutine_handle<> h);  // resumes h on this test's loop
+
+  // Runs the coroutine by itself, as with .async_jobs = 1 or .isolate.
+  void body() override;
+};
+
+namespace async {
+
+// Suspends the current async test for `s` seconds, or until the other
+// ready ones have had a turn.
+inline auto sleep(double s) {
+  struct [[nodiscard]] Timer {
+    double s;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) { detail::resume_after(s, h); }
+    void await_resume() {}
+  };
+  return Timer{s};
+}
+inline auto yield() { return sleep(0); }
+
+// Waits for `f`, a std::future or anything else with wait_for(),
+// without blocking the other async tests.
+template <class F>
+auto ready(F& f) {
+  struct [[nodiscard]] Waiter {
+    F& f;
+    static bool done(void* p) {
+      auto& f = *static_cast<F*>(p);
+      std::chrono::duration<int> zero{};  // declared by <mutex>
+      return f.wait_for(zero) == decltype(f.wait_for(zero))::ready;
+    }
+    bool await_ready() { return done(&f); }
+    void await_suspend(std::coroutine_handle<> h)
+    { detail::resume_when(done, &f, h); }
+    void await_resume() {}
+  };
+  return Waiter{f};
+}
+
+} // namespace async
+
+#define ZEST_FULLNAME_(pre, grp, uniq) pre##_##grp##_##uniq
+#define ZEST_FULLNAME(pre, grp, uniq) ZEST_FULLNAME_(pre, grp, uniq)
+
+#define ZEST_CLS(grp) ZEST_FULLNAME(_testcls, grp, __LINE__)
+#define ZEST_FUN(grp) zest::Test::run<ZEST_CLS(grp)>
+
+#define ZEST_TEST(C, g, t)                                             \
+  struct ZEST_CLS(g) { static zest::detail::Entry e; static bool b; }; \
+  template <> void ZEST_FUN(g)();                                      \
+  constinit zest::detail::Entry ZEST_CLS(g)::e{#g, t, __FILE__,        \
+    __LINE__, ZEST_FUN(g), nullptr,                                    \
+    zest::detail::Fixture<C, ZEST_CLS(g)>::make,                       \
+    zest::detail::Fixture<C, ZEST_CLS(g)>::drop, C::cache};            \
+  bool ZEST_CLS(g)::b = zest::Runner::add(ZEST_CLS(g)::e);             \
+  template <> void ZEST_FUN(g)()
+
+#define ZEST_ASYNC_TEST(C, g, t)                                       \
+  struct ZEST_CLS(g) { static zest::detail::Entry e; static bool b; }; \
+  template <> zest::async::Task zest::Test::task<ZEST_CLS(g)>();       \
+  template <> void ZEST_FUN(g)() {                                     \
+    zest::current<zest::Async>().task = zest::Test::task<ZEST_CLS(g)>(); } \
+  constinit zest::detail::Entry ZEST_CLS(g)::e{#g, t, __FILE__,        \
+    __LINE__, ZEST_FUN(g), nullptr,                                    \
+    zest::detail::Fixture<C, ZEST_CLS(g)>::make,                       \
+    zest::detail::Fixture<C, ZEST_CLS(g)>::drop, C::cache};            \
+  bool ZEST_CLS(g)::b = zest::Runner::add(ZEST_CLS(g)::e);             \
+template <> zest::async::Task zest::Test::task<ZEST_CLS(g)>()
+
+
+static inline int run(const Options& opt = {}) { return Runner::run(opt); }
+
+// Parses the command line into `opt` and runs the selected tests.
+int main(int argc, char** argv, Options opt = {});
+
+static auto& skip = Runner::skip;
+static auto& only = Runner::only;
+
+detail::Out out();  // to the current test, or std::cout
+
+// Makes `t` the current test on this thread until the scope ends, so
+// assertions made on helper threads count against the spawning test.
+struct Scope {
+  TestCase* prev;
+  Scope(TestCase* t) : prev(Runner::current) { Runner::current = t; }
+  ~Scope() { Runner::current = prev; }
+  Scope(const Scope&) = delete;
+};
+
+// Wraps f so that it runs with the caller's current test, e.g.
+// std::thread(zest::inherit([&]{ is_eq(1, x); }))
+template <class F>
+auto inherit(F f) {
+  return [t = Runner::current, f = std::move(f)](auto&&... a) mutable {
+    Scope s(t); return f(std::forward<decltype(a)>(a)...);
+  };
+}
+
+namespace detail {
+
+// How zest::stress runs its body.
+struct Stress {
+  int threads = 0;    // 0 = one per core
+  size_t iters = 0;   // calls per thread / 0 = no limit
+  double seconds = 0; // 0 = no limit
+};
+
+// zest::stress with the body called through a function pointer, as
+// body(ctx, thread, iteration).
+size_t stress(Stress s, void (*body)(void*, int, size_t), void* ctx);
+
+} // namespace detail
+
+// Runs f on s.threads threads released together; see "zest::stress".
+template <class F>
+size_t stress(detail::Stress s, F&& f) {
+  auto call = [](void* p, int k, size_t i) {
+    auto& f = *static_cast<std::remove_reference_t<F>*>(p);
+    if constexpr (std::is_invocable_v<decltype(f), int, size_t>) { f(k, i); }
+    else { f(k); }
+  };
+  return detail::stress(s, call, &f);
+}
+
+template <class T = TestCase>
+static inline T& current() {
+  if (!Runner::current)
+    throw "Called zest::current() while no current test";
+  return dynamic_cast<T&>(*Runner::current);
+}
+
+// The n a SCALING_BENCH is running at.
+static inline size_t bench_size() { return current<detail::Scaling>().n; }
+
+// The current group's T, built from `args` the first time any of its
+// tests asks for it, and destroyed after the group's last test.
+template <class T, class... A>
+static inline T& shared(A&&... args) {
+  if (!Runner::current || !Runner::current->shared)
+    throw "Called zest::shared() while no current test";
+  using detail::Shared;
+  auto& s = *Runner::current->shared;
+  std::lock_guard lk(s.mtx);
+  for (auto o = s.objs; o; o = o->next)
+    if (o->tag == &Shared::tag<T>) { return *static_cast<T*>(o->p); }
+  auto o = new Shared::Obj{&Shared::tag<T>, nullptr,
+                           [](void* p) { delete static_cast<T*>(p); }, s.objs};
+  try { o->p = new T(std::forward<A>(args)...); }
+  catch (...) { delete o; throw; }
+  return *static_cast<T*>((s.objs = o)->p);
+}
+
+#define ZEST_HERE std::source_location::current()
+#define TEST(Group, Title) ZEST_TEST(zest::TestCase, Group, Title)
+#define ASYNC_TEST(Group, Title) ZEST_ASYNC_TEST(zest::Async, Group, Title)
+#define BENCH(Group, Title) ZEST_TEST(zest::detail::Bench, Group, Title)
+#define LATENCY_BENCH(Group, Title)                                    \
+  ZEST_TEST(zest::detail::Latency, Group, Title)
+#define SCALING_BENCH(Group, Title, lo, hi, big)                       \
+  using ZEST_FULLNAME(_testfix, Group, __LINE__) =                     \
+    zest::detail::Scaled<(lo), (hi), zest::detail::Big::big>;                  \
+  ZEST_TEST(ZEST_FULLNAME(_testfix, Group, __LINE__), Group, Title)
+#define is_eq(e,a) zest::is_eq_(ZEST_HERE, #e,(e), #a,(a))
+#define is_ne(e,a) zest::is_ne_(ZEST_HERE, #e,(e), #a,(a))
+#define is_gt(e,a) zest::is_gt_(ZEST_HERE, #e,(e), #a,(a))
+#define is_lt(e,a) zest::is_lt_(ZEST_HERE, #e,(e), #a,(a))
+#define is_ge(e,a) zest::is_ge_(ZEST_HERE, #e,(e), #a,(a))
+#define is_le(e,a) zest::is_le_(ZEST_HERE, #e,(e), #a,(a))
+#define is_eq_range(e,a) zest::is_eq_range_(ZEST_HERE, #e,(e), #a,(a))
+#define is_eq_bytes(e,a,n) zest::is_eq_bytes_(ZEST_HERE, #e,(e), #a,(a), (n))
+#define is_p50_le(max, body) zest::is_quantile_le_(ZEST_HERE, 0.5, "p50", \
+  (max), #body, [&]() mutable { body; })
+#define is_p90_le(max, body) zest::is_quantile_le_(ZEST_HERE, 0.9, "p90", \
+  (max), #body, [&]() mutable { body; })
+#define is_p99_le(max, body) zest::is_quantile_le_(ZEST_HERE, 0.99, "p99", \
+  (max), #body, [&]() mutable { body; })
+#define is_p999_le(max, body) zest::is_quantile_le_(ZEST_HERE, 0.999, \
+  "p999", (max), #body, [&]() mutable { body; })
+#define is_near_all(e,a,...) \
+  zest::is_near_all_(ZEST_HERE, #e,(e), #a,(a), zest::detail::Near{__VA_ARGS__})
+
+#define is_thrown(E, body) \
+  zest::is_thrown_<E>(ZEST_HERE, #E, [&]() mutable { body; })
+
+#define is_allocs_le(max, body) \
+  zest::is_allocs_(ZEST_HERE, false, (max), #body, [&]() mutable { body; })
+#define is_bytes_le(max, body) \
+  zest::is_allocs_(ZEST_HERE, true, (max), #body, [&]() mutable { body; })
+
+} // namespace zest
+
+
+#if !defined(ZEST_SPLIT) || defined(ZEST_IMPLEMENTATION)
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <latch>
+#include <map>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace zest
+{
+
+struct Runner::clock : std::chrono::steady_clock {};
+
+// One set for the program: inline code from any file prints with them.
+inline const char *cRED, *cGRN, *cDIM, *cOFF=0;
+ZEST_DEF bool autocolor() {
+  return isatty(fileno(stdout)) && !getenv("NO_COLOR") &&
+    (getenv("TERM") && (getenv("TERM") != std::string_view("dumb")));
+}
+ZEST_DEF void color(bool enabled) {
+  cRED = !enabled ? "" : "\033[31m";
+  cGRN = !enabled ? "" : "\033[32m";
+  cDIM = !enabled ? "" : "\033[38;5;8m";
+  cOFF = !enabled ? "" : "\033[m";
+}
+
+
+namespace detail {
+
+ZEST_DEF void Perf::start() {
+  close();
+  ok = false; ops = 1;
+#ifdef __linux__
+  static const std::pair<uint32_t, uint64_t> ev[N] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  };
+  for (int i=0; i<N; ++i) {
+    perf_event_attr a;
+    memset(&a, 0, sizeof a);
+    a.size = sizeof a; a.type = ev[i].first; a.config = ev[i].second;
+    a.disabled = !i; a.exclude_kernel = 1; a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                    PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd[i] = syscall(SYS_perf_event_open, &a, 0, -1, i ? fd[0] : -1, 0);
+    if (fd[0] >= 0) { continue; }
+    if (!warned.exchange(true))
+      fprintf(stderr, "zest: no hardware counters (%s), see "
+              "/proc/sys/kernel/perf_event_paranoid\n", strerror(errno));
+    return;
+  }
+  ok = true;
+  ioctl(fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+ZEST_DEF void Perf::stop() {
+  if (fd[0] < 0) { return; }
+#ifdef __linux__
+  ioctl(fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  for (int i=0; i<N; ++i) {
+    uint64_t v[3];  // value, time enabled, time running
+    bool got = (fd[i] >= 0) && (::read(fd[i], v, sizeof v) == sizeof v);
+    count[i] = (got && v[2]) ? (double)v[0] * v[1] / v[2] : -1;
+  }
+#endif
+  close();
+}
+ZEST_DEF void Perf::close() {
+  for (auto& f : fd) { if (f >= 0) { ::close(f); f = -1; } }
+}
+
+// A failure as file, line and message, each ended by a NUL.
+ZEST_DEF Str pack(const Failure& f) {
+  Str s;
+  s += f.file; s += '\0';
+  s += std::to_string(f.line); s += '\0';
+  s += f.message; s += '\0';
+  return s;
+}
+
+ZEST_DEF std::vector<Failure> unpack(std::string_view s) {
+  std::vector<Failure> fs;
+  auto next = [&] {
+    auto z = s.find('\0');
+    Str x(s.substr(0, z));
+    s.remove_prefix(std::min(z + 1, s.size()));
+    return x;
+  };
+  while (!s.empty()) {
+    auto file = next(), line = next();
+    fs.push_back({file, atoi(line.c_str()), next()});
+  }
+  return fs;
+}
+
+// Streams a record of each finished test to .jsonl and .junit files.
+// Workers push copies of their Results onto a lock-free stack, and one
+// writer thread takes the whole stack at once and reverses it, so the
+// records are written in the order they came. Each batch is flushed,
+// so a run that is killed still leaves what had finished.
+struct Stream {
+  struct Node { Result r; Node* next = nullptr; bool end = false; };
+  std::atomic<Node*> head = nullptr;
+  FILE *jsonl = nullptr, *junit = nullptr;
+  std::thread writer;
+
+  Stream(const char* jsonl_path, const char* junit_path) {
+    auto open = [](const char* path) {
+      if (!path) { return (FILE*)nullptr; }
+      FILE* f = fopen(path, "w");
+      if (!f) { fprintf(stderr, "zest: cannot write %s\n", path); }
+      return f;
+    };
+    jsonl = open(jsonl_path);
+    junit = open(junit_path);
+    if (junit)
+      fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n"
+            "<testsuite name=\"zest\">\n", junit);
+    writer = std::thread([this]{ write(); });
+  }
+
+  ~Stream() {
+    push(new Node{{}, nullptr, true});
+    writer.join();
+    if (junit) { fputs("</testsuite>\n</testsuites>\n", junit); fclose(junit); }
+    if (jsonl) { fclose(jsonl); }
+  }
+
+  void push(const Result& r) { push(new Node{r}); }
+
+  void push(Node* n) {
+    n->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(n->next, n, std::memory_order_release,
+                                       std::memory_order_relaxed)) {}
+    head.notify_one();
+  }
+
+  void write() {
+    for (bool end = false; !end;) {
+      head.wait(nullptr, std::memory_order_acquire);
+      Node *n = head.exchange(nullptr, std::memory_order_acquire), *rev = nullptr;
+      while (n) { rev = std::exchange(n->next, rev); std::swap(n, rev); }
+      for (n = rev; n; delete std::exchange(n, n->next)) {
+        if (n->end) { end = true; continue; }
+        if (jsonl) { record_jsonl(n->r); }
+        if (junit) { record_junit(n->r); }
+      }
+      if (jsonl) { fflush(jsonl); }
+      if (junit) { fflush(junit); }
+    }
+  }
+
+  static Str json(std::string_view s) {
+    Str o = "\"";
+    for (unsigned char c : s) {
+      if ((c == '"') || (c == '\\')) { o += '\\'; o += c; }
+      else if (c == '\n') { o += "\\n"; }
+      else if (c < 0x20) {
+        char buf[8]; snprintf(buf, sizeof buf, "\\u%04x", c); o += buf;
+      }
+      else { o += c; }
+    }
+    return o + "\"";
+  }
+
+  static Str xml(std::string_view s) {
+    Str o;
+    for (unsigned char c : s) {
+      switch (c) {
+        case '&': o += "&amp;"; break;
+        case '<': o += "&lt;"; break;
+        case '>': o += "&gt;"; break;
+        case '"': o += "&quot;"; break;
+        default:
+          if ((c < 0x20) && (c != '\n') && (c != '\t')) { o += '?'; }
+          else { o += c; }
+      }
+    }
+    return o;
+  }
+
+  void record_jsonl(const Result& r) {
+    Str f;
+    for (auto& x : unpack(r.failures))
+      f += Str(f.empty() ? "" : ",") + "{\"file\":" + json(x.file) +
+           ",\"line\":" + std::to_string(x.line) + ",\"message\":" +
+           json(x.message) + "}";
+    fprintf(jsonl, "{\"group\":%s,\"title\":%s,\"file\":%s,\"line\":%d,"
+            "\"status\":\"%s\",\"wall\":%.6f,\"cpu\":%.6f,\"failures\":[%s]}\n",
+            json(r.group).c_str(), json(r.title).c_str(), json(r.file).c_str(),
+            r.line, r.failed ? "fail" : "pass", r.wall, r.cpu, f.c_str());
+  }
+
+  void record_junit(const Result& r) {
+    fprintf(junit, "  <testcase classname=\"%s\" name=\"%s\" file=\"%s\" "
+            "line=\"%d\" time=\"%.6f\"", xml(r.group).c_str(),
+            xml(r.title).c_str(), xml(r.file).c_str(), r.line, r.wall);
+    if (!r.failed) { fputs("/>\n", junit); return; }
+    fputs(">\n", junit);
+    for (auto& x : unpack(r.failures)) {
+      Str m = xml(x.message);
+      auto eol = m.find('\n');
+      fprintf(junit, "    <failure message=\"%s\">%s:%d: %s</failure>\n",
+              m.substr(0, eol).c_str(), xml(x.file).c_str(), x.line, m.c_str());
+    }
+    if (r.failures.empty()) { fputs("    <failure/>\n", junit); }
+    fputs("  </testcase>\n", junit);
+  }
+};
+
+
+struct Console : Reporter {
+  void on_group_start(const Str& group, std::ostream& out) override
+  { out << "\n[" << group << "]\n"; }
+
+  // A failed test's details are held back to go under its ✗ line,
+  // which is printed once its time is known.
+  std::mutex m;
+  std::map<const TestCase*, Str> held;
+
+  void on_failure(TestCase& t, std::string_view file, int line,
+                  std::string_view msg) override {
+    std::lock_guard lk(m);
+    held[&t] += Str(file) + ":" + std::to_string(line) + ": FAIL: " + Str(msg);
+  }
+
+  Str take(const TestCase* t) {
+    std::lock_guard lk(m);
+    auto i = held.find(t);
+    if (i == held.end()) { return ""; }
+    Str s = std::move(i->second);
+    held.erase(i);
+    return s;
+  }
+
+  bool times = true;  // show each test's wall time
+  int slowest = 0;    // list this many of the slowest tests
+
+  static Str duration(double s) {
+    char buf[32];
+    if (s < 1e-3) snprintf(buf, sizeof buf, "%.0f µs", s * 1e6);
+    else if (s < 1) snprintf(buf, sizeof buf, "%.3g ms", s * 1e3);
+    else snprintf(buf, sizeof buf, "%.3g s", s);
+    return buf;
+  }
+
+  void on_test_end(TestCase& t) override {
+    auto& o = *t.out;
+    if (!t.failed) {
+      o << cGRN << " ✓ " << t.title << cOFF;
+      t.details(o);
+      if (t.perf.ok) { counters(o, t.perf); }
+    }
+    else { o << cRED << " ✗ " << t.title << cOFF; }
+    if (times) { o << cDIM << "  " << duration(t.wall) << cOFF; }
+    o << "\n" << take(&t);
+    if (t.failed) { o.flush(); }  // in case a later test crashes
+  }
+
+  void on_group_end(const Str&, std::ostream& out) override
+  { out.flush(); }
+
+  static void counters(std::ostream& o, const Perf& p) {
+    auto per = [&](int i){ return p.count[i] / p.ops; };
+    const char* names[] = {"cycles", "", "br-miss", "L1-miss", "LLC-miss"};
+    auto op = (p.ops == 1) ? "" : "/op";
+    char buf[48];
+    o << cDIM;
+    for (int i : {Perf::CYCLES, Perf::BRANCH_MISSES, Perf::L1D_MISSES,
+                  Perf::LLC_MISSES}) {
+      if (p.count[i] < 0) { continue; }
+      snprintf(buf, sizeof buf, "  %.3g %s%s", per(i), names[i], op);
+      o << buf;
+      if ((i != Perf::CYCLES) || (p.count[Perf::INSNS] <= 0)) { continue; }
+      snprintf(buf, sizeof buf, "  %.2f IPC",
+               p.count[Perf::INSNS] / std::max(p.count[i], 1.0));
+      o << buf;
+    }
+    o << cOFF;
+  }
+
+  void on_summary(const Summary& s, std::ostream& out) override {
+    if (slowest > 0) {
+      std::vector v(s.tests.begin(), s.tests.end());
+      auto n = std::min<size_t>(slowest, v.size());
+      auto by_wall = [](auto a, auto b){ return a->wall > b->wall; };
+      std::partial_sort(v.begin(), v.begin() + n, v.end(), by_wall);
+      out << "\n[" << n << " slowest]\n";
+      for (auto t : std::span(v).first(n)) {
+        char buf[64];
+        snprintf(buf, sizeof buf, "%9s %9s  ", duration(t->wall).c_str(),
+                 ("cpu " + duration(t->cpu)).c_str());
+        out << cDIM << buf << cOFF << t->group << ": " << t->title << "\n";
+      }
+    }
+    auto C = s.nfail ? cRED : cGRN;
+    out << C << "\n┌──────┐";
+    out << C << "\n│ " << (s.nfail ? "FAIL" : " OK ") << " │";
+    if (s.nskip) { out << cDIM << " (" << s.nskip << " skipped)"; }
+    if (s.ncached) { out << cDIM << " (" << s.ncached << " cached)"; }
+    if (s.nstop) { out << cDIM << " (stopped: " << s.nstop << " not run)"; }
+    if (s.shard.count) {
+      out << cDIM << " (shard " << s.shard.index << "/" << s.shard.count
+          << ": " << s.tests.size() << " tests)";
+    }
+    out << C << "\n└──────┘";
+    out << cOFF << "\n" << std::flush;
+  }
+};
+
+// Writes into stdout's own buffer, which stdio locks, so the runner's
+// output stays in order with printf and std::cout from tests. Piped
+// to a file or CI log, it is written out only when that fills up or
+// the stream is flushed.
+struct Sink : std::streambuf {
+  int sync() override { return fflush(stdout); }
+  int overflow(int c) override
+  { return (c == EOF) ? 0 : fputc(c, stdout); }
+  std::streamsize xsputn(const char* s, std::streamsize n) override
+  { return fwrite(s, 1, n, stdout); }
+};
+
+
+struct Filter::Regex {
+  std::regex group, title;
+  Regex(const Str& g, const Str& t)
+    : group(g, std::regex::optimize), title(t, std::regex::optimize) {}
+};
+
+ZEST_DEF Filter::Filter(std::string_view pat, bool regex, bool exclude)
+  : exclude(exclude) {
+  auto at = pat.find('/');
+  group = pat.substr(0, at);
+  title = (at == pat.npos) ? "" : pat.substr(at + 1);
+  if (regex) { re = new Regex{group, title}; }
+  if (group.empty()) { group = "*"; }
+  if (title.empty()) { title = "*"; }
+}
+ZEST_DEF bool Filter::match(const char* g, const char* t) const {
+  if (re) return std::regex_search(g, re->group) &&
+                 std::regex_search(t, re->title);
+  return !fnmatch(group.c_str(), g, 0) && !fnmatch(title.c_str(), t, 0);
+}
+struct Filters::List { std::vector<Filter> all; };
+
+ZEST_DEF Filters::Filters(std::initializer_list<Filter> fs)
+  : list(new List{fs}) {}
+
+ZEST_DEF void Filters::add(Filter f) {
+  auto l = new List{list ? *list : List{}};
+  l->all.push_back(std::move(f));
+  list = l;
+}
+
+ZEST_DEF bool Filters::wanted(const char* g, const char* t) const {
+  if (!list) { return true; }
+  auto& fs = list->all;
+  bool in = true;
+  for (auto& f : fs) { if (!f.exclude) { in = false; break; } }
+  for (auto& f : fs) {
+    if (f.match(g, t)) {
+      if (f.exclude) { return false; }
+      in = true;
+    }
+  }
+  return in;
+}
+
+// Runs f(0..n-1) on `jobs` threads. Each worker takes tasks from the
+// front of its own deque and steals from the back of the others.
+template <class F>
+void steal_each(size_t n, int jobs, F&& f) {
+  struct Queue { std::mutex m; std::deque<size_t> d; };
+  std::vector<Queue> qs(jobs);
+  for (size_t i=0; i<n; ++i) { qs[i % jobs].d.push_back(i); }
+  auto take = [&](int w, size_t& i) {
+    for (int k=0; k<jobs; ++k) {
+      auto& q = qs[(w + k) % jobs];
+      std::lock_guard lk(q.m);
+      if (q.d.empty()) { continue; }
+      if (k) { i = q.d.back(); q.d.pop_back(); }
+      else  { i = q.d.front(); q.d.pop_front(); }
+      return true;
+    }
+    return false;
+  };
+  std::vector<std::thread> workers;
+  for (int w=0; w<jobs; ++w)
+    workers.emplace_back([&, w]{ for (size_t i; take(w, i);) f(i); });
+  for (auto& w : workers) { w.join(); }
+}
+
+// What earlier runs recorded about each test, keyed by "group\ttitle".
+struct History {
+  struct Last { double seconds = 0; bool failed = false; };
+  static inline std::map<Str, Last> last;
+
+  template <class T>
+  static Str key(const T* t) { return Str(t->group) + "\t" + t->title; }
+
+  static void load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { return; }
+    char line[1100], g[512], t[512], st[8];
+    double d;
+    while (fgets(line, sizeof line, f)) {
+      strcpy(st, "pass");  // older files have no status column
+      if (sscanf(line, "%511[^\t]\t%511[^\t]\t%lf\t%7s", g, t, &d, st) >= 3)
+        last[Str(g) + "\t" + t] = {d, !strcmp(st, "fail")};
+    }
+    fclose(f);
+  }
+
+  // Records `ran`, which includes tests that failed without finishing.
+  static void save(const char* path, const std::vector<const Result*>& ran) {
+    for (auto r : ran) {
+      auto& l = last[key(r)];
+      if (r->done) { l.seconds = r->wall; }
+      l.failed = r->failed;
+    }
+    auto tmp = Str(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) { return; }
+    for (auto& [k, l] : last) {
+      fprintf(f, "%s\t%.6g\t%s\n", k.c_str(), l.seconds,
+              l.failed ? "fail" : "pass");
+    }
+    fclose(f);
+    rename(tmp.c_str(), path);
+  }
+};
+
+// Tests that passed in a binary with the same contents, which need not
+// run again. Each line is "binary\tgroup\ttitle\ttime", time being
+// when the pass was last used. Lines unused for a week are dropped.
+struct Cache {
+  static inline std::map<Str, time_t> passed;  // "binary\tgroup\ttitle"
+
+  // A hash of the running executable, or "" where it can't be read.
+  static const Str& binary() {
+    static const Str id = [] {
+      FILE* f = fopen("/proc/self/exe", "rb");
+      if (!f) { return Str(); }
+      uint64_t h = 14695981039346656037u, w[1024];
+      for (size_t n; (n = fread(w, 1, sizeof w, f)) > 0;) {
+        if (n % 8) { memset((char*)w + n, 0, 8 - n % 8); }
+        for (size_t i = 0; i < (n + 7) / 8; ++i) { h = (h ^ w[i]) * 1099511628211u; }
+      }
+      fclose(f);
+      char s[20];
+      snprintf(s, sizeof s, "%016llx", (unsigned long long)h);
+      return Str(s);
+    }();
+    return id;
+  }
+
+  template <class T>
+  static Str key(const T* t) { return binary() + "\t" + History::key(t); }
+
+  static void load(const char* path) {
+    if (binary().empty()) {
+      fprintf(stderr, "zest: cannot read /proc/self/exe, not caching\n");
+      return;
+    }
+    FILE* f = fopen(path, "r");
+    if (!f) { return; }
+    char line[1100], b[20], g[512], t[512];
+    long long when;
+    while (fgets(line, sizeof line, f)) {
+      if (sscanf(line, "%19[^\t]\t%511[^\t]\t%511[^\t]\t%lld", b, g, t, &when) == 4)
+        passed[Str(b) + "\t" + g + "\t" + t] = when;
+    }
+    fclose(f);
+  }
+
+  // Whether r passed before, in which case it counts as used now.
+  static bool hit(const Result* r) {
+    if (binary().empty()) { return false; }
+    auto p = passed.find(key(r));
+    if (p == passed.end()) { return false; }
+    p->second = time(nullptr);
+    return true;
+  }
+
+  static void save(const char* path, const std::vector<const Result*>& ran) {
+    if (binary().empty()) { return; }
+    time_t now = time(nullptr);
+    for (auto r : ran) {
+      if (r->failed) { passed.erase(key(r)); }
+      else if (r->entry->cache) { passed[key(r)] = now; }
+    }
+    auto tmp = Str(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) { return; }
+    for (auto& [k, when] : passed) {
+      if (now - when < 7 * 24 * 3600)
+        fprintf(f, "%s\t%lld\n", k.c_str(), (long long)when);
+    }
+    fclose(f);
+    rename(tmp.c_str(), path);
+  }
+};
+
+// Samples the stack of whichever thread is using CPU time, every ms of
+// it, on SIGPROF, and tags it with that thread's current test. Samples
+// go to a fixed buffer; save() appends them to a file as folded stacks,
+// "Group/title;outer;..;inner count", which flamegraph.pl reads.
+struct Profiler {
+  static constexpr int DEPTH = 48;
+  static constexpr size_t CAP = 1 << 16;
+  struct Sample { const char *group, *title; int depth; void* pc[DEPTH]; };
+  static inline std::unique_ptr<Sample[]> samples;
+  static inline std::atomic<size_t> next = 0;
+
+  static void on_signal(int);
+
+  static void start() {
+    if (!samples) { samples.reset(new Sample[CAP]); }
+    next = 0;
+#if __has_include(<execinfo.h>)
+    void* pc[4];
+    backtrace(pc, 4);  // loads the unwinder now, not in the handler
+#endif
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &sa, nullptr);
+    itimerval every_ms = {{0, 1000}, {0, 1000}};
+    setitimer(ITIMER_PROF, &every_ms, nullptr);
+  }
+
+  static void stop() {
+    itimerval off = {};
+    setitimer(ITIMER_PROF, &off, nullptr);
+  }
+
+  static Str frame(void* pc) {
+    Dl_info info;
+    if (!dladdr(pc, &info) || !info.dli_fname) { return "??"; }
+    if (info.dli_sname) {
+      int st = 0;
+      char* s = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &st);
+      Str name = st ? info.dli_sname : s;
+      free(s);
+      return name;
+    }
+    auto base = strrchr(info.dli_fname, '/');
+    char off[32];
+    snprintf(off, sizeof off, "+0x%zx", (size_t)((char*)pc - (char*)info.dli_fbase));
+    return (base ? base + 1 : info.dli_fname) + Str(off);
+  }
+
+  static void save(const char* path) {
+    size_t n = std::min(next.load(), CAP);
+    if (next > CAP)
+      fprintf(stderr, "zest: profile full, %zu samples lost\n", next - CAP);
+    std::map<void*, Str> names;
+    std::map<Str, size_t> folded;
+    for (size_t i = 0; i < n; ++i) {
+      auto& s = samples[i];
+      Str stack = s.group ? Str(s.group) + "/" + s.title : "(zest)";
+      for (int k = s.depth - 1; k >= 2; --k) {  // less on_signal and its caller
+        auto& name = names[s.pc[k]];
+        if (name.empty()) { name = frame(s.pc[k]); }
+        stack += ";" + name;
+      }
+      ++folded[stack];
+    }
+    next = 0;
+    Str out;
+    for (auto& [stack, count] : folded)
+      out += stack + " " + std::to_string(count) + "\n";
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0666);
+    if (fd < 0) { fprintf(stderr, "zest: cannot write %s\n", path); return; }
+    if (write(fd, out.data(), out.size()) < 0) {}  // one write, for workers
+    close(fd);
+  }
+};
+
+
+} // namespace detail
+
+struct Runner::Groups : std::vector<Str> {};
+struct Runner::Tests : std::vector<Result*> {};
+struct Runner::Todo : std::vector<std::pair<Str, Tests>> {};
+
+ZEST_DEF Runner::Groups Runner::skipped, Runner::onlies;
+ZEST_DEF Runner::Console Runner::console;
+ZEST_DEF Reporter* Runner::reporter = &console;
+ZEST_DEF Runner::Sink Runner::buffer;
+ZEST_DEF std::ostream Runner::sink{&buffer};
+
+// Watches the tests running in this process, and ends the run when
+// one overruns its timeout. Isolated runs kill the worker instead.
+struct Runner::Watchdog {
+  std::mutex m;
+  std::condition_variable cv;
+  std::map<TestCase*, clock::time_point> running;
+  std::thread thread;
+  bool stop = false;
+
+  void start(TestCase* t) {
+    if (limit(t) <= 0) { return; }
+    std::lock_guard lk(m);
+    auto d = std::chrono::duration<double>(limit(t));
+    running[t] = clock::now() + std::chrono::ceil<clock::duration>(d);
+    if (!thread.joinable()) {
+      stop = false;
+      thread = std::thread([this]{ watch(); });
+    }
+    cv.notify_one();
+  }
+
+  void end(TestCase* t) { std::lock_guard lk(m); running.erase(t); }
+  ~Watchdog() { if (thread.joinable()) thread.detach(); }
+
+  void finish() {
+    { std::lock_guard lk(m); stop = true; cv.notify_one(); }
+    if (thread.joinable()) { thread.join(); }
+  }
+
+  void watch() {
+    std::unique_lock lk(m);
+    while (!stop) {
+      auto next = clock::time_point::max();
+      for (auto& [t, deadline] : running) {
+        if (clock::now() >= deadline) { expire(t); }
+        next = std::min(next, deadline);
+      }
+      if (next == clock::time_point::max()) { cv.wait(lk); }
+      else { cv.wait_until(lk, next); }
+    }
+  }
+
+  [[noreturn]] static void expire(TestCase* t) {
+    sink.flush();
+    fputs(console.take(t).c_str(), stderr);
+    fprintf(stderr, "\n%s:%d: TIMEOUT: %s: %s did not finish in %g s\n",
+            t->file, t->line, t->group, t->title,
+            limit(t));
+    std::abort();
+  }
+};
+
+struct Runner::Msg {
+  int kind, test, failed = 0, len = 0, packed = 0, notes = 0, details = 0;
+  double wall = 0, cpu = 0, limit = 0;
+  double counts[detail::Perf::N] = {}, ops = 1;  // of an END, with .counters
+  bool counted = false;
+};
+
+namespace detail {
+
+// The reporter of a forked worker. It keeps what the parent needs to
+// call the real reporter's hooks for each test.
+struct Relay : Reporter {
+  Str details;
+  Perf perf;
+  void on_test_end(TestCase& t) override {
+    std::ostringstream os;
+    t.details(os);
+    details = os.str();
+    std::copy(std::begin(t.perf.count), std::end(t.perf.count), perf.count);
+    perf.ops = t.perf.ops; perf.ok = t.perf.ok;
+  }
+};
+
+// A test of a worker, as the parent's reporter sees it.
+struct Replayed : TestCase {
+  Str shown;  // its details(), from the worker
+  void details(std::ostream& os) const override { os << shown; }
+};
+
+} // namespace detail
+
+
+ZEST_DEF bool Runner::add(Entry& e)
+{ e.next = entries; entries = &e; return true; }
+
+ZEST_DEF bool Runner::add(TestCase& c, Str g, Str t, Run* r, Str f, int l) {
+  auto keep = [](const Str& s){ return strdup(s.c_str()); };
+  return add(*new Entry{keep(g), keep(t), keep(f), l, r, &c});
+}
+
+ZEST_DEF void Runner::skip(Str group) { skipped.push_back(group); }
+
+ZEST_DEF void Runner::only(Str group) { onlies.push_back(group); }
+
+ZEST_DEF double Runner::limit(const TestCase* t)
+{ return t->timeout ? t->timeout : opt.timeout; }
+
+ZEST_DEF Runner::Watchdog& Runner::watchdog() { static Watchdog w; return w; }
+
+ZEST_DEF double Runner::cpu_now(bool shared) {
+  timespec ts;
+  clock_gettime(shared ? CLOCK_THREAD_CPUTIME_ID
+                       : CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+ZEST_DEF void Runner::tally(const Result& r) {
+  if (r.failed && opt.max_failures && (++failures >= opt.max_failures))
+    stopped = true;
+}
+
+ZEST_DEF TestCase* Runner::make(const Result& r, Shared& s) {
+  auto& e = *r.entry;
+  auto t = e.test ? e.test : e.make();
+  t->run=e.run; t->group=e.group; t->title=e.title;
+  t->file=e.file; t->line=e.line; t->shared = &s;
+  t->failed = 0; t->done = false;
+  t->failures.clear();
+  return t;
+}
+
+ZEST_DEF void Runner::run_test(Result& r, TestCase* t, std::ostream& out) {
+  t->out = &out;
+  current = t;
+  reporter->on_test_start(*t);
+  bool shared = threaded;  // other workers' CPU time would be counted
+  auto t0 = clock::now();
+  double c0 = cpu_now(shared);
+  if (!isolated) { watchdog().start(t); }
+  t->before();
+  try {
+    if (opt.counters) { t->perf.start(); }
+    t->body();
+    t->perf.stop();
+  } catch (...) {
+    t->perf.stop();
+    t->fail("Uncaught exception");
+    if (!isolated) {  // ends the run: print the test before it goes
+      watchdog().end(t);
+      r.wall = t->wall =
+        std::chrono::duration<double>(clock::now() - t0).count();
+      r.failed = t->failed;
+      reporter->on_test_end(*t);
+      out.flush();
+      current = nullptr;
+      if (r.entry->drop) { r.entry->drop(t); }
+      std::rethrow_exception(std::current_exception());
+    }
+  }
+  t->after();
+  if (!isolated) { watchdog().end(t); }
+  end_test(r, t, std::chrono::duration<double>(clock::now() - t0).count(),
+           cpu_now(shared) - c0);
+}
+
+ZEST_DEF void Runner::end_test(Result& r, TestCase* t, double wall,
+                              double cpu) {
+  r.wall = t->wall = wall;
+  r.cpu = t->cpu = cpu;
+  t->done = r.done = true;
+  r.failed = t->failed;
+  r.packed = t->pack();
+  r.failures = std::move(t->failures);
+  tally(r);
+  if (stream && !isolated) { stream->push(r); }
+  reporter->on_test_end(*t);
+  current = nullptr;
+  if (r.entry->drop) { r.entry->drop(t); }
+}
+
+ZEST_DEF int Runner::run_parallel(Todo& todo, int jobs) {
+  std::vector<std::ostringstream> outs(todo.size());
+  std::vector<bool> fin(todo.size());
+  std::atomic<int> nfail=0;
+  std::atomic<bool> stop=false;
+  std::exception_ptr err;
+  std::mutex m;
+  size_t next=0;
+  threaded = true;
+  detail::steal_each(todo.size(), jobs, [&](size_t i) {
+    try {
+      if (!stop && !stopped)
+        nfail += run_group(todo[i].first, todo[i].second, outs[i]);
+    } catch (...) {
+      std::lock_guard lk(m);
+      if (!err) { err = std::current_exception(); }
+      stop = true;
+    }
+    std::lock_guard lk(m);
+    for (fin[i] = true; (next < fin.size()) && fin[next]; ++next)
+      sink << outs[next].str() << std::flush;
+  });
+  threaded = false;
+  if (err) { std::rethrow_exception(err); }
+  return nfail;
+}
+
+ZEST_DEF bool Runner::read_all(int fd, void* p, size_t n) {
+  for (ssize_t r; n; n -= r, p = (char*)p + r)
+    if ((r = read(fd, p, n)) <= 0) { return false; }
+  return true;
+}
+
+ZEST_DEF void Runner::write_all(int fd, const void* p, size_t n) {
+  for (ssize_t r; n; n -= r, p = (const char*)p + r)
+    if ((r = write(fd, p, n)) <= 0) { _exit(1); }
+}
+
+ZEST_DEF void Runner::send(int fd, Msg m, Str s, const Str& packed,
+                          const Str& notes, const Str& details) {
+  m.len = s.size(); m.packed = packed.size(); m.notes = notes.size();
+  m.details = details.size();
+  s.insert(0, (const char*)&m, sizeof m);
+  s += packed;
+  s += notes;
+  s += details;
+  write_all(fd, s.data(), s.size());
+}
+
+[[noreturn]] ZEST_DEF void Runner::work(Todo& todo, int rx, int tx) {
+  isolated = true;
+  detail::Relay relay;  // the parent calls the per-test hooks
+  reporter = &relay;
+  auto profile = profiling();
+  if (profile) { detail::Profiler::start(); }  // timers are not inherited
+  for (int task[2]; read_all(rx, task, sizeof task);) {
+    auto& tests = todo[task[0]].second;
+    std::ostringstream rest;  // printed after the tests, by the teardown
+    {
+      Shared shared;
+      int last = -1;
+      double slowest = opt.timeout;  // allowed for the teardown
+      // Its own failures count towards .max_failures too.
+      for (int i = task[1]; (i < (int)tests.size()) && !stopped; ++i) {
+        auto& r = *tests[i];
+        std::ostringstream out;
+        group_out = &out;
+        send(tx, {START, i});
+        auto t = make(r, shared);
+        if (t->timeout) { send(tx, {.kind=LIMIT, .test=i, .limit=t->timeout}); }
+        slowest = std::max(slowest, t->timeout);
+        last = i;
+        run_test(r, t, out);
+        Msg m{END, i, r.failed, 0, 0, 0, 0, r.wall, r.cpu};
+        std::copy(std::begin(relay.perf.count), std::end(relay.perf.count),
+                  m.counts);
+        m.ops = relay.perf.ops; m.counted = relay.perf.ok;
+        send(tx, m, out.str(), r.packed, r.failures, relay.details);
+      }
+      group_out = &rest;
+      if (last >= 0) { send(tx, {.kind=TEARDOWN, .test=last, .limit=slowest}); }
+    }
+    group_out = nullptr;
+    send(tx, {DONE, 0}, rest.str());
+  }
+  if (profile) { detail::Profiler::stop(); detail::Profiler::save(profile); }
+  _exit(0);
+}
+
+ZEST_DEF int Runner::run_isolated(Todo& todo, int jobs) {
+  struct Worker {
+    pid_t pid=0;
+    int tx=-1, rx=-1, group=-1, test=-1, next=0;
+    int torn=-1;  // the last test, while the group's teardown runs
+    clock::time_point started, deadline = clock::time_point::max();
+    double limit = 0;
+    bool overran = false, cancelled = false;
+    std::unique_ptr<detail::Replayed> t;  // test, for the reporter
+  };
+  std::vector<Worker> ws(jobs);
+  std::vector<std::ostringstream> outs(todo.size());
+  std::vector<bool> fin(todo.size()), began(todo.size());
+  std::deque<std::pair<int,int>> queue;
+  int nfail=0;
+  size_t next=0;
+  for (int g=0; g < (int)todo.size(); ++g) { queue.push_back({g, 0}); }
+  auto finish = [&](int g) {
+    if (began[g]) { reporter->on_group_end(todo[g].first, outs[g]); }
+    for (fin[g] = true; (next < fin.size()) && fin[next]; ++next)
+      sink << outs[next].str() << std::flush;
+  };
+  auto spawn = [&](Worker& w) {
+    int down[2], up[2];
+    if (pipe(down) || pipe(up)) { throw "zest: pipe() failed"; }
+    sink << std::flush; std::cout << std::flush;
+    if (!(w.pid = fork())) {
+      for (auto& o : ws) { if (o.rx >= 0) { close(o.rx); close(o.tx); } }
+      close(down[1]); close(up[0]);
+      work(todo, down[0], up[1]);
+    }
+    if (w.pid < 0) { throw "zest: fork() failed"; }
+    close(down[0]); close(up[1]);
+    w.tx = down[1]; w.rx = up[0];
+  };
+  auto dispatch = [&](Worker& w) {
+    if (queue.empty() || stopped) { close(w.tx); w.tx = -1; return; }
+    auto [g, k] = queue.front(); queue.pop_front();
+    if (!k) { reporter->on_group_start(todo[g].first, outs[g]); }
+    began[g] = true;
+    w.group = g; w.next = k;
+    int task[2] = {g, k};
+    write_all(w.tx, task, sizeof task);
+  };
+  auto reap = [&](Worker& w) {
+    int st = 0;
+    close(w.rx); w.rx = -1;
+    if (w.tx >= 0) { close(w.tx); w.tx = -1; }
+    waitpid(w.pid, &st, 0);
+    if (w.group < 0) { return; }
+    auto& tests = todo[w.group].second;
+    if (w.cancelled) {
+      if (std::none_of(tests.begin(), tests.end(),
+                       [](auto r){ return r->done; })) {
+        outs[w.group].str("");  // nothing of it ran: leave it out
+        began[w.group] = false;
+      }
+      finish(w.group); w.group = -1; return;
+    }
+    auto why = [&](auto& o) {
+      if (w.overran) o << "Timed out after " << w.limit << " s";
+      else if (WIFSIGNALED(st)) o << "Killed by " << strsignal(WTERMSIG(st));
+      else o << "Worker exited with status " << WEXITSTATUS(st);
+    };
+    std::chrono::duration<double> d = clock::now() - w.started;
+    if (w.torn >= 0) {  // in a shared object's destructor: fails the group
+      auto& r = *tests[w.torn];
+      detail::Replayed t;
+      t.group=r.group; t.title="(teardown)"; t.file=r.file; t.line=r.line;
+      t.out = &outs[w.group];
+      reporter->on_test_start(t);
+      { auto o = t.fail(); why(o); o << " in the group's teardown\n"; }
+      t.wall = d.count();
+      reporter->on_test_end(t);
+      r.failures += t.failures;
+      if (!r.failed) { r.failed = 1; ++nfail; tally(r); }
+    }
+    if (w.test >= 0) {
+      auto& r = *tests[w.test];
+      auto& t = *w.t;  // the fixture died with the worker
+      { auto o = t.fail(); why(o); o << "\n"; }
+      t.wall = r.wall = d.count();
+      reporter->on_test_end(t);
+      r.failed = 1;
+      r.failures = std::move(t.failures);
+      w.t.reset();
+      tally(r);
+      if (stream) { stream->push(r); }
+      ++nfail;
+      w.next = w.test + 1;
+    }
+    if ((w.next < (int)tests.size()) && !stopped)
+      queue.push_front({w.group, w.next});
+    else { finish(w.group); }
+    w.group = w.test = w.torn = -1;
+    w.deadline = clock::time_point::max(); w.overran = false;
+    if (!queue.empty() && !stopped) { spawn(w); dispatch(w); }
+  };
+  for (auto& w : ws) { spawn(w); dispatch(w); }
+  for (std::vector<pollfd> fds;;) {
+    fds.clear();
+    for (auto& w : ws) { if (w.rx >= 0) fds.push_back({w.rx, POLLIN, 0}); }
+    if (fds.empty()) { break; }
+    auto next = std::min_element(ws.begin(), ws.end(),
+      [](auto& a, auto& b){ return a.deadline < b.deadline; })->deadline;
+    int wait = -1;
+    if (next != clock::time_point::max()) {
+      using ms = std::chrono::milliseconds;
+      wait = std::max<int>(std::chrono::ceil<ms>(next - clock::now()).count(), 0);
+    }
+    if (poll(fds.data(), fds.size(), wait) < 0) { continue; }
+    for (auto& w : ws) {
+      if ((w.group < 0) || w.overran || (clock::now() < w.deadline)) continue;
+      kill(w.pid, SIGKILL);
+      w.overran = true;
+      w.deadline = clock::time_point::max();
+    }
+    for (auto& w : ws) {
+      if (w.rx < 0) { continue; }
+      auto ready = std::find_if(fds.begin(), fds.end(),
+                                [&](auto& f){ return f.fd == w.rx; });
+      if ((ready == fds.end()) || !ready->revents) { continue; }
+      // Records still in the pipe of a cancelled worker are dropped, so
+      // the summary counts those tests as not run, as in a serial run.
+      if (w.cancelled) { reap(w); continue; }
+      Msg m;
+      Str text;
+      if (!read_all(w.rx, &m, sizeof m)) { reap(w); continue; }
+      text.resize(m.len + m.packed + m.notes + m.details);
+      if (text.size() && !read_all(w.rx, text.data(), text.size())) {
+        reap(w); continue;
+      }
+      if ((m.kind == START) || (m.kind == LIMIT)) {
+        if (m.kind == START) {
+          w.test = m.test; w.started = clock::now();
+          auto& r = *todo[w.group].second[m.test];
+          w.t = std::make_unique<detail::Replayed>();
+          w.t->group=r.group; w.t->title=r.title;
+          w.t->file=r.file; w.t->line=r.line;
+          w.t->out = &outs[w.group];
+          reporter->on_test_start(*w.t);
+        }
+        w.limit = (m.kind == LIMIT) ? m.limit : opt.timeout;
+        auto d = std::chrono::duration<double>(w.limit);
+        if (w.limit > 0)
+          w.deadline = w.started + std::chrono::ceil<clock::duration>(d);
+      }
+      if (m.kind == END) {
+        auto& r = *todo[w.group].second[m.test];
+        r.wall = m.wall; r.cpu = m.cpu; r.failed = m.failed;
+        r.done = true;
+        r.packed = text.substr(m.len, m.packed);
+        r.failures = text.substr(m.len + m.packed, m.notes);
+        outs[w.group] << text.substr(0, m.len);
+        auto& t = *w.t;
+        t.failed = m.failed; t.wall = m.wall; t.cpu = m.cpu; t.done = true;
+        t.shown = text.substr(m.len + m.packed + m.notes);
+        std::copy(std::begin(m.counts), std::end(m.counts), t.perf.count);
+        t.perf.ops = m.ops; t.perf.ok = m.counted;
+        for (auto& f : detail::unpack(r.failures))
+          reporter->on_failure(t, f.file, f.line, f.message + "\n");
+        reporter->on_test_end(t);
+        w.t.reset();
+        nfail += m.failed ? 1 : 0;
+        tally(r);
+        if (stream) { stream->push(r); }
+        w.test = -1; w.next = m.test + 1;
+        w.deadline = clock::time_point::max();
+      }
+      if (m.kind == TEARDOWN) {
+        w.torn = m.test; w.started = clock::now(); w.limit = m.limit;
+        auto d = std::chrono::duration<double>(w.limit);
+        if (w.limit > 0)
+          w.deadline = w.started + std::chrono::ceil<clock::duration>(d);
+      }
+      if (m.kind == DONE) {
+        w.torn = -1; w.deadline = clock::time_point::max();
+        outs[w.group] << text.substr(0, m.len);
+        finish(w.group); w.group = -1; dispatch(w);
+      }
+    }
+    for (auto& w : ws) {  // cancel the rest once .max_failures is hit
+      if (!stopped || (w.rx < 0) || w.cancelled) { continue; }
+      kill(w.pid, SIGKILL);
+      w.cancelled = true;
+    }
+  }
+  for (size_t g = 0; g < fin.size(); ++g) { if (!fin[g]) finish(g); }
+  return nfail;
+}
+
+ZEST_DEF uint64_t Runner::hash(std::string_view s) {
+  uint64_t h = 14695981039346656037u;
+  for (unsigned char c : s) { h = (h ^ c) * 1099511628211u; }
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9u;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebu;
+  return h ^ (h >> 31);
+}
+
+ZEST_DEF void Runner::failed_first(Todo& todo) {
+  auto rank = [](auto& group) {
+    int best = 2;
+    for (auto r : group.second) {
+      auto l = detail::History::last.find(detail::History::key(r));
+      best = std::min(best, (l == detail::History::last.end()) ? 1
+                            : l->second.failed ? 0 : 2);
+    }
+    return best;
+  };
+  std::vector<std::pair<int, size_t>> order;
+  for (size_t i = 0; i < todo.size(); ++i)
+    order.push_back({rank(todo[i]), i});
+  std::stable_sort(order.begin(), order.end(),
+                   [](auto& a, auto& b){ return a.first < b.first; });
+  Todo sorted;
+  for (auto [r, i] : order) { sorted.push_back(std::move(todo[i])); }
+  todo = std::move(sorted);
+}
+
+ZEST_DEF void Runner::shard(Todo& todo, Shard sh) {
+  std::map<Result*, int> owner;
+  std::vector<std::pair<double, Result*>> timed;
+  for (auto& [g, tests] : todo) for (auto t : tests) {
+    auto d = detail::History::last.find(detail::History::key(t));
+    if (opt.shard_by_time && (d != detail::History::last.end()))
+      timed.push_back({d->second.seconds, t});
+    else owner[t] = hash(detail::History::key(t)) % sh.count;
+  }
+  std::sort(timed.begin(), timed.end(), [](auto& a, auto& b) {
+    if (a.first != b.first) { return a.first > b.first; }
+    return detail::History::key(a.second) < detail::History::key(b.second);
+  });
+  std::vector<double> load(sh.count);
+  for (auto& [d, t] : timed) {
+    auto k = std::min_element(load.begin(), load.end()) - load.begin();
+    load[k] += d;
+    owner[t] = k;
+  }
+  for (auto& [g, tests] : todo)
+    std::erase_if(tests, [&](auto t){ return owner[t] != sh.index - 1; });
+  std::erase_if(todo, [](auto& g){ return g.second.empty(); });
+}
+
+ZEST_DEF const char* Runner::profiling()
+{ return opt.profile ? opt.profile : getenv("ZEST_PROFILE"); }
+
+ZEST_DEF int Runner::jobs(const Options& opt) {
+  int n = opt.jobs;
+  if (!n && getenv("ZEST_JOBS")) { n = atoi(getenv("ZEST_JOBS")); }
+  if (n < 0) { n = std::thread::hardware_concurrency(); }
+  return std::max(n, 1);
+}
+
+
+namespace detail {
+
+ZEST_DEF void Profiler::on_signal(int) {
+  int e = errno;
+  size_t i = next.fetch_add(1, std::memory_order_relaxed);
+  if (i < CAP) {
+    auto& s = samples[i];
+    auto t = Runner::current;
+    s.group = t ? t->group : nullptr;
+    s.title = t ? t->title : nullptr;
+#if __has_include(<execinfo.h>)
+    s.depth = backtrace(s.pc, DEPTH);
+#else
+    s.depth = 0;
+#endif
+  }
+  errno = e;
+}
+
+// The failure being written on this thread. Its test stays locked
+// until the Out goes.
+ZEST_DEF std::ostringstream& message() {
+  static thread_local std::ostringstream m;
+  return m;
+}
+
+ZEST_DEF Out::~Out() {
+  if (failing) {
+    if (Runner::stream || Runner::isolated) {  // for the parent
+      auto m = message().str();
+      if (m.ends_with('\n')) { m.pop_back(); }
+      failing->failures += pack({Str(file), line, m});
+    }
+    Runner::reporter->on_failure(*failing, file, line, message().view());
+  }
+}
+
+
+inline double median(std::vector<double> v) {
+  auto mid = v.begin() + v.size()/2;
+  std::nth_element(v.begin(), mid, v.end());
+  return v.empty() ? 0 : *mid;
+}
+
+// Pins the calling thread to one CPU while it lives, then restores its
+// affinity. The first pin also warns of what makes timings noisy:
+// frequency scaling, turbo, and other work on the system.
+struct Pin {
+#ifdef __linux__
+  cpu_set_t old;
+#endif
+  bool pinned = false;
+
+  explicit Pin(int cpu) {
+    if (cpu < 0) { return; }
+    static std::once_flag once;
+    std::call_once(once, check, cpu);
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pinned = !sched_getaffinity(0, sizeof old, &old) &&
+             !sched_setaffinity(0, sizeof set, &set);
+    static std::atomic<bool> warned = false;
+    if (!pinned && !warned.exchange(true))
+      fprintf(stderr, "zest: cannot pin to CPU %d (%s)\n", cpu, strerror(errno));
+#endif
+  }
+
+  ~Pin() {
+#ifdef __linux__
+    if (pinned) { sched_setaffinity(0, sizeof old, &old); }
+#endif
+  }
+
+  static void check(int cpu) {
+    auto read = [](const Str& path) {
+      char buf[64] = "";
+      if (FILE* f = fopen(path.c_str(), "r")) {
+        if (fscanf(f, "%63s", buf) != 1) { buf[0] = 0; }
+        fclose(f);
+      }
+      return Str(buf);
+    };
+    Str sys = "/sys/devices/system/cpu/";
+    auto gov = read(sys + "cpu" + std::to_string(cpu) + "/cpufreq/scaling_governor");
+    if (!gov.empty() && (gov != "performance"))
+      fprintf(stderr, "zest: CPU %d scales its frequency (governor %s)\n",
+              cpu, gov.c_str());
+    if ((read(sys + "intel_pstate/no_turbo") == "0") ||
+        (read(sys + "cpufreq/boost") == "1"))
+      fprintf(stderr, "zest: turbo boost is on\n");
+    double load = 0;
+    unsigned n = std::thread::hardware_concurrency();
+    if ((getloadavg(&load, 1) == 1) && n && (load > n / 2.0))
+      fprintf(stderr, "zest: system is loaded (%.1f on %u CPUs)\n", load, n);
+  }
+};
+
+
+// The BENCH results of the baseline file.
+struct Baseline {
+  static inline std::map<Str, Bench::Mark> marks;  // "group\ttitle" → Mark
+};
+
+// Times each call of op into a Histogram for bench_time seconds, after
+// a tenth of that to warm up. One clock read per call marks both the
+// end of one and the start of the next; the cost of the loop itself
+// is measured first and taken off.
+template <class F>
+Histogram latency(F&& op) {
+  using clock = Runner::clock;
+  static const uint64_t overhead = [] {
+    uint64_t least = -1;
+    auto t = clock::now();
+    for (int i = 0; i < 1000; ++i) {
+      auto t1 = clock::now();
+      least = std::min<uint64_t>(least, (t1 - t).count());
+      t = t1;
+    }
+    return least;
+  }();
+  auto& o = Runner::opt;
+  auto t = Runner::current;
+  Histogram h;
+  auto for_ = [](double s) {
+    return std::chrono::ceil<clock::duration>(std::chrono::duration<double>(s));
+  };
+  auto end = clock::now() + for_(o.bench_time / 10);
+  while ((clock::now() < end) && !t->failed) { op(); }
+  end = clock::now() + for_(o.bench_time);
+  for (auto t0 = clock::now(); (t0 < end) && !t->failed;) {
+    op();
+    auto t1 = clock::now();
+    uint64_t ns = std::chrono::nanoseconds(t1 - t0).count();
+    h.record((ns > overhead) ? ns - overhead : 0);
+    t0 = t1;
+  }
+  return h;
+}
+
+ZEST_DEF double Bench::sample(size_t n) {
+  using clock = std::chrono::steady_clock;
+  auto t0 = clock::now();
+  for (size_t i=0; (i < n) && !failed; ++i) { run(); }
+  return std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+}
+
+ZEST_DEF void Bench::body() {
+  Pin pin(Runner::opt.bench_cpu);
+  measure(Runner::opt.bench_time);
+  if (!failed && !unreliable()) { compare(); }
+}
+
+ZEST_DEF bool Bench::unreliable() const {
+  double max = Runner::opt.bench_max_cv;
+  return max && (cv > max);
+}
+
+ZEST_DEF void Bench::measure(double seconds) {
+  auto& o = Runner::opt;
+  double goal = seconds * 1e9 / std::max(o.bench_reps, 1);
+  for (iters = 1; !failed; iters *= 2)
+    if (sample(iters) >= goal) { break; }
+  // Warm up for bench_warmup samples, then until the last three agree
+  // within half of bench_max_cv, for at most bench_reps more.
+  std::vector<double> warm;
+  auto settled = [&] {
+    if (!o.bench_warmup || !o.bench_max_cv) { return true; }
+    if (warm.size() < 3) { return false; }
+    auto [lo, hi] = std::minmax_element(warm.end() - 3, warm.end());
+    return *hi - *lo <= *lo * o.bench_max_cv / 2;
+  };
+  for (int i=0; !failed && ((i < o.bench_warmup) ||
+                ((i < o.bench_warmup + o.bench_reps) && !settled())); ++i)
+    warm.push_back(sample(iters));
+  std::vector<double> samples;  // ns/op
+  if (perf.ok) { perf.start(); }  // count only the measured samples
+  for (int i=0; (i < o.bench_reps) && !failed; ++i)
+    samples.push_back(sample(iters) / iters);
+  perf.stop();
+  reps = samples.size();
+  perf.ops = iters * reps;
+  std::vector<double> dev;
+  ns = median(samples);
+  for (auto x : samples) { dev.push_back(std::abs(x - ns)); }
+  mad = median(dev);
+  cv = ns ? 1.4826 * mad / ns : 0;  // σ from the MAD, if it were normal
+}
+
+ZEST_DEF void Bench::compare() {
+  auto& o = Runner::opt;
+  auto b = Baseline::marks.find(History::key(this));
+  if ((b == Baseline::marks.end()) || o.update_baseline) { return; }
+  base = b->second.ns;
+  auto se = [](double mad, int n){ return 1.858 * mad / std::sqrt(n); };
+  double s = std::hypot(se(mad, reps),
+                        se(b->second.mad, b->second.reps));
+  if ((ns > base * (1 + o.bench_threshold)) && (ns - base > 3 * s)) {
+    fail() << ns << " ns/op is " << (int)std::round(100 * (ns/base - 1))
+           << "% slower than the baseline " << base << " ns/op\n";
+  }
+}
+
+ZEST_DEF void Bench::details(std::ostream& os) const {
+  char buf[96];
+  int n = snprintf(buf, sizeof buf, "  %.4g ns/op ±%.2g", ns, mad);
+  if (base)
+    snprintf(buf+n, sizeof buf-n, "  %+.0f%% vs baseline", 100*(ns/base-1));
+  os << cDIM << buf << cOFF;
+  if (unreliable())
+    os << cRED << "  unreliable (cv " << (int)std::round(100 * cv) << "%)" << cOFF;
+}
+
+ZEST_DEF Str Bench::pack() const {
+  Mark m{ns, mad, unreliable() ? 0 : reps};
+  return Str((const char*)&m, sizeof m);
+}
+
+ZEST_DEF void Bench::load(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { return; }
+  char g[512], t[512];
+  Mark m;
+  while (fscanf(f, "%511[^\t]\t%511[^\t]\t%lf\t%lf\t%d\n",
+                g, t, &m.ns, &m.mad, &m.reps) == 5)
+    Baseline::marks[Str(g) + "\t" + t] = m;
+  fclose(f);
+}
+
+ZEST_DEF void Bench::save(const char* path,
+                          std::span<const Result* const> ran) {
+  bool changed = false;
+  for (auto r : ran) {
+    Mark m;
+    if (r->failed || (r->packed.size() != sizeof m)) { continue; }
+    memcpy(&m, r->packed.data(), sizeof m);
+    auto key = History::key(r);
+    if (!m.reps || (Baseline::marks.count(key) && !Runner::opt.update_baseline))
+      continue;
+    Baseline::marks[key] = m;
+    changed = true;
+  }
+  if (!changed) { return; }
+  auto tmp = Str(path) + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "w");
+  if (!f) { return; }
+  for (auto& [key, m] : Baseline::marks)
+    fprintf(f, "%s\t%.6g\t%.6g\t%d\n", key.c_str(), m.ns, m.mad, m.reps);
+  fclose(f);
+  rename(tmp.c_str(), path);
+}
+
+ZEST_DEF Str Histogram::show(double ns) {
+  char buf[32];
+  if (ns < 1e3) snprintf(buf, sizeof buf, "%.0f ns", ns);
+  else if (ns < 1e6) snprintf(buf, sizeof buf, "%.3g µs", ns * 1e-3);
+  else if (ns < 1e9) snprintf(buf, sizeof buf, "%.3g ms", ns * 1e-6);
+  else snprintf(buf, sizeof buf, "%.3g s", ns * 1e-9);
+  return buf;
+}
+
+ZEST_DEF Str Histogram::summary() const {
+  Str s;
+  for (auto [name, q] : {std::pair{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99},
+                         {"p999", 0.999}})
+    s += Str(name) + " " + show(at(q)) + "  ";
+  return s + "max " + show(max);
+}
+
+ZEST_DEF void Latency::body() {
+  Pin pin(Runner::opt.bench_cpu);
+  hist = latency([this]{ run(); });
+}
+
+ZEST_DEF void Latency::details(std::ostream& os) const
+{ os << cDIM << "  " << hist.summary() << cOFF; }
+
+ZEST_DEF bool quantile_le(std::source_location loc, double q, const char* name,
+                          double max, const char* body_str,
+                          void (*body)(void*), void* ctx) {
+  TestCase* t = Runner::current;
+  if (!t) { throw "Called is_p*_le while no current test"; }
+  auto h = latency([=]{ body(ctx); });
+  double v = h.at(q), lim = max * 1e9;
+  if (v <= lim) { return true; }
+  t->fail(loc.file_name(), loc.line()) << body_str << ": " << name << " "
+    << Histogram::show(v) << " > " << Histogram::show(lim) << "  ("
+    << h.summary() << ")\n";
+  return false;
+}
+
+ZEST_DEF size_t stress(Stress s, void (*body)(void*, int, size_t), void* ctx) {
+  auto t = Runner::current;
+  if (!t) { throw "Called zest::stress while no current test"; }
+  int n = s.threads ? s.threads
+                    : std::max(1u, std::thread::hardware_concurrency());
+  bool once = !s.iters && !s.seconds;
+  auto d = std::chrono::duration<double>(s.seconds);
+  std::latch go(n);
+  std::atomic<size_t> calls = 0;
+  std::vector<std::thread> ts;
+  for (int k = 0; k < n; ++k) ts.emplace_back([&, k] {
+    Scope scope(t);
+    go.arrive_and_wait();
+    auto end = Runner::clock::now() +
+               std::chrono::ceil<Runner::clock::duration>(d);
+    size_t i = 0;
+    try {
+      for (; (once ? !i : (!s.iters || (i < s.iters))) && !t->failed; ++i) {
+        if (s.seconds && !(i % 64) && (Runner::clock::now() >= end)) break;
+        body(ctx, k, i);
+      }
+    } catch (...) {
+      t->fail() << "Uncaught exception on stress thread " << k << "\n";
+    }
+    calls += i;
+  });
+  for (auto& th : ts) { th.join(); }
+  return calls;
+}
+
+ZEST_DEF const char* Scaling::name(Big b) {
+  const char* names[] = {"?", "O(1)", "O(log n)", "O(n)", "O(n log n)",
+                         "O(n²)"};
+  return names[int(b)];
+}
+
+ZEST_DEF double Scaling::f(Big b, double n) {
+  double lg = std::log2(std::max(n, 2.0));  // not 0 at n = 1
+  switch (b) {
+    case O_log_n: return lg;
+    case O_n: return n;
+    case O_n_log_n: return n * lg;
+    case O_n2: return n * n;
+    default: return 1;
+  }
+}
+
+ZEST_DEF std::pair<double, double> Scaling::fit(Big b) const {
+  double lc = 0, err = 0;
+  for (auto [n, t] : points()) { lc += std::log(t / f(b, n)); }
+  lc /= npoints;
+  for (auto [n, t] : points()) { err += std::pow(lc - std::log(t / f(b, n)), 2); }
+  return {std::exp(lc), std::sqrt(err / npoints)};
+}
+
+ZEST_DEF void Scaling::body() {
+  Pin pin(Runner::opt.bench_cpu);
+  int steps = 0;
+  for (size_t m = std::max<size_t>(lo, 1); m <= hi; m *= 2) { ++steps; }
+  npoints = 0;
+  for (n = std::max<size_t>(lo, 1); !failed && (n <= hi); n *= 2) {
+    measure(Runner::opt.bench_time / std::max(steps, 1));
+    measured[npoints++] = {n, ns};
+  }
+  if (failed || (npoints < 3)) { return; }
+  double best = INFINITY;
+  for (Big b = O_1; b <= O_n2; b = Big(int(b) + 1)) {
+    auto [c, e] = fit(b);
+    if (e < best) { best = e; big = b; coef = c; rms = e; }
+  }
+  if ((expect == O_auto) || (big <= expect) ||
+      (fit(expect).second < 2 * rms))
+    return;
+  auto o = fail();
+  o << "grows as " << name(big) << ", expected " << name(expect) << ":\n";
+  for (auto [n, t] : points())
+    o << "    n=" << n << "  " << Histogram::show(t) << "\n";
+}
+
+ZEST_DEF void Scaling::details(std::ostream& os) const {
+  if (big == O_auto) { return; }
+  Str f = name(big);
+  char buf[128];
+  snprintf(buf, sizeof buf, "  %s  %.3g ns × %s  ±%.0f%%  n=%zu..%zu",
+           f.c_str(), coef, f.substr(2, f.size() - 3).c_str(),
+           100 * (std::exp(rms) - 1),
+           measured[0].first, measured[npoints - 1].first);
+  os << cDIM << buf << cOFF;
+}
+
+ZEST_DEF Str Scaling::pack() const { return ""; }
+
+
+// Drives the coroutines of async tests on one thread. Handles may be
+// posted from any thread; timers fire and polls run on this one, so
+// nothing resumes a test once its loop is gone.
+struct Loop {
+  using clock = std::chrono::steady_clock;
+  struct Poll { bool (*done)(void*); void* p; std::coroutine_handle<> h; };
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::coroutine_handle<>> ready;
+  std::multimap<clock::time_point, std::coroutine_handle<>> timers;
+  std::vector<Poll> polls;  // of async::ready()
+  std::map<TestCase*, double> cpu;  // seconds spent resuming each test
+  bool woken = false;
+
+  // Notifies under the lock: the loop may be gone once it is released.
+  void post(std::coroutine_handle<> h) {
+    std::lock_guard lk(m);
+    ready.push_back(h);
+    cv.notify_one();
+  }
+
+  void at(clock::time_point when, std::coroutine_handle<> h) {
+    std::lock_guard lk(m);
+    timers.insert({when, h});
+    cv.notify_one();
+  }
+
+  void poll(Poll p) {
+    std::lock_guard lk(m);
+    polls.push_back(p);
+    cv.notify_one();
+  }
+
+  void wake() {
+    std::lock_guard lk(m);
+    woken = true;
+    cv.notify_one();
+  }
+
+  // Waits for something to be ready, and resumes it.
+  void step();
+};
+
+// While polls are pending, it checks them after naps that grow from
+// 20 µs to 1 ms.
+ZEST_DEF void Loop::step() {
+  std::unique_lock lk(m);
+  for (auto nap = std::chrono::microseconds(20);;) {
+    auto now = clock::now();
+    for (; !timers.empty() && (timers.begin()->first <= now);) {
+      ready.push_back(timers.begin()->second);
+      timers.erase(timers.begin());
+    }
+    std::erase_if(polls, [&](auto& p) {
+      return p.done(p.p) && (ready.push_back(p.h), true);
+    });
+    if (!ready.empty() || woken) { break; }
+    auto until = timers.empty() ? clock::time_point::max()
+                                : timers.begin()->first;
+    if (!polls.empty()) {
+      until = std::min(until, now + nap);
+      nap = std::min(2 * nap, std::chrono::microseconds(1000));
+    }
+    if (until == clock::time_point::max()) { cv.wait(lk); }
+    else { cv.wait_until(lk, until); }
+  }
+  woken = false;
+  auto now = std::move(ready);
+  ready.clear();
+  lk.unlock();
+  for (auto h : now) {
+    double c0 = Runner::cpu_now(true);
+    Runner::current = nullptr;
+    h.resume();  // sets Runner::current to the test it belongs to
+    if (auto t = Runner::current) { cpu[t] += Runner::cpu_now(true) - c0; }
+  }
+}
+
+ZEST_DEF void wake(Loop& l) { l.wake(); }
+
+ZEST_DEF void resume_after(double s, std::coroutine_handle<> h) {
+  auto d = std::chrono::duration<double>(s);
+  using clock = Loop::clock;
+  dynamic_cast<Async&>(*Runner::current).loop->at(
+    clock::now() + std::chrono::ceil<clock::duration>(d), h);
+}
+
+ZEST_DEF void resume_when(bool (*done)(void*), void* p,
+                          std::coroutine_handle<> h) {
+  dynamic_cast<Async&>(*Runner::current).loop->poll({done, p, h});
+}
+
+} // namespace detail
+
+ZEST_DEF detail::Out TestCase::fail(std::string_view file, int line) {
+  std::unique_lock lk(mtx);
+  ++failed;
+  detail::message().str("");
+  return {std::move(lk), detail::message(), this, file, line};
+}
+
+ZEST_DEF void Async::post(std::coroutine_handle<> h) { loop->post(h); }
+
+ZEST_DEF void Async::start(detail::Loop& l) {
+  loop = &l;
+  run();
+  task.h.promise().test = this;
+  task.h.promise().loop = &l;
+  l.post(task.h);
+}
+
+ZEST_DEF void Async::body() {
+  detail::Loop l;
+  start(l);
+  while (!task.done()) { l.step(); }
+  Runner::current = this;
+  if (task.h.promise().err) std::rethrow_exception(task.h.promise().err);
+}
+
+
+ZEST_DEF int Runner::run_group(const Str& group, Tests& tests,
+                             std::ostream& out) {
+  int nfail=0;
+  if (stopped) { return 0; }
+  reporter->on_group_start(group, out);
+  struct Restore {
+    std::ostream* prev;
+    ~Restore() { group_out = prev; }
+  } restore{std::exchange(group_out, &out)};
+  {
+    Shared shared;
+    TestCase* t = nullptr;  // built for tests[i], and not yet run
+    size_t i = 0;
+    while ((i < tests.size()) && !stopped) {
+      if (!t) { t = make(*tests[i], shared); }
+      if (dynamic_cast<Async*>(t) && (opt.async_jobs > 1)) {
+        i = run_async(tests, i, t, shared, out);
+      } else {
+        run_test(*tests[i++], std::exchange(t, nullptr), out);
+      }
+    }
+    if (t && tests[i]->entry->drop) { tests[i]->entry->drop(t); }
+  }
+  for (auto r : tests) { nfail += r->failed ? 1 : 0; }
+  reporter->on_group_end(group, out);
+  return nfail;
+}
+
+// Runs tests[i..] while they are async, up to .async_jobs at once on
+// one Loop, starting from `t`, the fixture built for tests[i]. Each
+// writes to its own buffer, and the buffers are printed in order.
+// Leaves in `t` the fixture built for the test after them, if any.
+ZEST_DEF size_t Runner::run_async(Tests& tests, size_t i, TestCase*& t,
+                                Shared& shared, std::ostream& out) {
+  struct Slot {
+    Result* r;
+    Async* a;
+    std::ostringstream out;
+    clock::time_point t0 = clock::now();
+    ~Slot() { if (a && r->entry->drop) r->entry->drop(a); }
+  };
+  detail::Loop loop;
+  std::deque<Slot> slots;  // in test order; printed from the front
+  int active = 0;
+  for (;;) {
+    for (Async* a; (active < opt.async_jobs) && !stopped &&
+                   (a = dynamic_cast<Async*>(t));) {
+      auto& s = slots.emplace_back(tests[i++], a);
+      t = ((i < tests.size()) && !stopped) ? make(*tests[i], shared) : nullptr;
+      a->out = &s.out;
+      current = a;
+      reporter->on_test_start(*a);
+      watchdog().start(a);
+      a->before();
+      a->start(loop);
+      current = nullptr;
+      ++active;
+    }
+    for (auto& s : slots) {
+      if (!s.a || !s.a->task.done()) { continue; }
+      auto a = std::exchange(s.a, nullptr);
+      current = a;
+      auto err = a->task.h.promise().err;
+      if (err) { a->fail("Uncaught exception"); }
+      a->after();
+      watchdog().end(a);
+      --active;
+      if (err) {
+        s.r->failed = a->failed;
+        a->wall = std::chrono::duration<double>(clock::now() - s.t0).count();
+        reporter->on_test_end(*a);
+        current = nullptr;
+        if (s.r->entry->drop) { s.r->entry->drop(a); }
+        for (auto& x : slots) { out << x.out.str(); }
+        out.flush();
+        std::rethrow_exception(err);
+      }
+      auto wall = std::chrono::duration<double>(clock::now() - s.t0);
+      end_test(*s.r, a, wall.count(), loop.cpu[a]);
+    }
+    for (; !slots.empty() && !slots.front().a; slots.pop_front())
+      out << slots.front().out.str();
+    if (!active) { break; }
+    loop.step();
+  }
+  return i;
+}
+
+ZEST_DEF int Runner::run(const Options& opt) {
+  int nfail=0, nskip=0;
+  if (!cOFF) { color(autocolor()); }
+  Runner::opt = opt;
+  if (getenv("ZEST_UPDATE_BASELINE")) { Runner::opt.update_baseline = true; }
+  reporter = opt.reporter ? opt.reporter : &console;
+  if (auto n = getenv("ZEST_TIMEOUT")) { Runner::opt.timeout = atof(n); }
+  if (auto n = getenv("ZEST_MAX_FAILURES")) {
+    Runner::opt.max_failures = atoi(n);
+  }
+  if (getenv("ZEST_COUNTERS")) { Runner::opt.counters = true; }
+  if (auto n = getenv("ZEST_BENCH_CPU")) { Runner::opt.bench_cpu = atoi(n); }
+  failures = 0;
+  stopped = false;
+  console.times = opt.times;
+  console.slowest = opt.slowest;
+  if (auto n = getenv("ZEST_SLOWEST")) { console.slowest = atoi(n); }
+  auto base = opt.baseline ? opt.baseline : getenv("ZEST_BASELINE");
+  if (base) { detail::Bench::load(base); }
+  auto hist = opt.history ? opt.history : getenv("ZEST_HISTORY");
+  if (hist) { detail::History::load(hist); }
+  auto& sh = Runner::opt.shard;
+  if (auto e = getenv("ZEST_SHARD")) { sscanf(e, "%d/%d", &sh.index, &sh.count); }
+  if (sh.count && ((sh.index < 1) || (sh.index > sh.count)))
+    throw "zest: shard must be i/n with 1 <= i <= n";
+  std::vector<Entry*> all;
+  for (auto e = entries; e; e = e->next) {
+    if (opt.filter.wanted(e->group, e->title)) { all.push_back(e); }
+  }
+  std::reverse(all.begin(), all.end());
+  std::stable_sort(all.begin(), all.end(),
+                   [](auto a, auto b){ return strcmp(a->group, b->group) < 0; });
+  std::vector<Result> results;
+  for (auto e : all) results.push_back({e, e->group, e->title, e->file, e->line});
+  Todo todo;
+  for (auto& r : results) {
+    if (todo.empty() || (todo.back().first != r.group)) {
+      todo.push_back({r.group, {}});
+    }
+    todo.back().second.push_back(&r);
+  }
+  std::erase_if(todo, [&](auto& g) {
+    auto in = [&](auto& v){ return std::count(v.begin(), v.end(), g.first); };
+    bool skip = in(skipped) || (!onlies.empty() && !in(onlies));
+    if (skip) { nskip += g.second.size(); }
+    return skip;
+  });
+  if (sh.count) { shard(todo, sh); }
+  if (Runner::opt.failed_first || getenv("ZEST_FAILED_FIRST"))
+    failed_first(todo);
+  if (opt.list) {
+    for (auto& [g, tests] : todo)
+      for (auto r : tests) { sink << r->group << "/" << r->title << "\n"; }
+    sink.flush();
+    return 0;
+  }
+  auto cache = opt.cache ? opt.cache : getenv("ZEST_CACHE");
+  int ncached = 0;
+  if (cache) {
+    detail::Cache::load(cache);
+    for (auto& [g, tests] : todo) {
+      ncached += std::erase_if(tests,
+                               [](auto r){ return detail::Cache::hit(r); });
+    }
+    std::erase_if(todo, [](auto& g){ return g.second.empty(); });
+  }
+  int n = std::min<int>(jobs(opt), todo.size());
+  bool fork = opt.isolate || getenv("ZEST_ISOLATE");
+  auto jsonl = opt.jsonl ? opt.jsonl : getenv("ZEST_JSONL");
+  auto junit = opt.junit ? opt.junit : getenv("ZEST_JUNIT");
+  std::optional<Stream> records;
+  if (jsonl || junit) { stream = &records.emplace(jsonl, junit); }
+  auto profile = profiling();
+  if (auto f = profile ? fopen(profile, "w") : nullptr) { fclose(f); }
+  if (profile && !fork) { detail::Profiler::start(); }
+  try {
+    if (fork && todo.size()) { nfail = run_isolated(todo, n); }
+    else if (n > 1) { nfail = run_parallel(todo, n); }
+    else for (auto& [g, tests] : todo) nfail += run_group(g, tests, sink);
+  } catch (...) {
+    watchdog().finish();
+    stream = nullptr;
+    if (profile && !fork) { detail::Profiler::stop(); }
+    sink.flush();
+    throw;
+  }
+  watchdog().finish();
+  stream = nullptr;
+  records.reset();
+  if (profile && !fork) {
+    detail::Profiler::stop();
+    detail::Profiler::save(profile);
+  }
+  Summary sum{nfail, nskip, {}, sh};
+  sum.ncached = ncached;
+  std::vector<const Result*> done, ran;
+  for (auto& [g, tests] : todo) for (auto r : tests) {
+    if (r->done) { done.push_back(r); }
+    else if (stopped && !r->failed) { ++sum.nstop; }
+    if (r->done || r->failed) { ran.push_back(r); }
+  }
+  sum.tests = done;
+  if (base) { detail::Bench::save(base, done); }
+  if (hist) { detail::History::save(hist, ran); }
+  if (cache) { detail::Cache::save(cache, ran); }
+  reporter->on_summary(sum, sink);
+  sink.flush();
+  return nfail ? 1 : 0;
+}
+
+
+// Parses the command line into `opt` and runs the selected tests.
+ZEST_DEF int main(int argc, char** argv, Options opt) {
+  const char* usage =
+    "usage: %s [options] [GROUP[/TITLE]]...\n"
+    "  GROUP[/TITLE]    run only matching tests (globs)\n"
+    "  -x, --exclude P  skip tests matching P\n"
+    "  -E, --regex      patterns are regexes searched for in names\n"
+    "  -l, --list       print the selected tests and exit\n"
+    "  -j, --jobs N     run groups on N threads (-1 = per core)\n"
+    "  -r, --repeat N   run the selected tests N times\n"
+    "  -i, --isolate    run groups in forked workers\n"
+    "  -f, --fail-fast  stop at the first failed test\n"
+    "  --history FILE   record each test's last result and time\n"
+    "  --failed-first   run groups that failed last time first\n"
+    "  --jsonl FILE     stream a JSON record of each test to FILE\n"
+    "  --junit FILE     stream JUnit XML to FILE\n"
+    "  --profile FILE   write folded stacks of each test to FILE\n"
+    "  --cache FILE     skip tests that passed in this same binary\n"
+    "  --counters       show cycles, IPC and cache misses\n"
+    "  --pin CPU        pin benches to CPU, and warn of noise\n"
+    "  --max-failures N stop after N failed tests\n"
+    "  -h, --help       show this help\n";
+  bool regex = false;
+  int repeat = 1;
+  std::vector<std::pair<Str, bool>> pats;  // pattern, exclude
+  for (int i = 1; i < argc; ++i) {
+    std::string_view a = argv[i], v;
+    auto eq = a.find('=');
+    if (a.starts_with("--") && (eq != a.npos)) {
+      v = a.substr(eq + 1); a = a.substr(0, eq);
+    } else if ((a.size() > 2) && (a[0] == '-') && strchr("jrx", a[1])) {
+      v = a.substr(2); a = a.substr(0, 2);  // -j8
+    }
+    auto arg = [&]() -> std::string_view {
+      if (v.data()) { return v; }
+      if (i + 1 < argc) { return argv[++i]; }
+      fprintf(stderr, "zest: %s needs a value\n", argv[i]);
+      exit(2);
+    };
+    auto num = [&] { return atoi(Str(arg()).c_str()); };
+    if ((a == "-h") || (a == "--help")) { printf(usage, argv[0]); return 0; }
+    else if ((a == "-l") || (a == "--list")) { opt.list = true; }
+    else if ((a == "-E") || (a == "--regex")) { regex = true; }
+    else if ((a == "-i") || (a == "--isolate")) { opt.isolate = true; }
+    else if ((a == "-j") || (a == "--jobs")) { opt.jobs = num(); }
+    else if ((a == "-r") || (a == "--repeat")) { repeat = num(); }
+    else if ((a == "-f") || (a == "--fail-fast")) { opt.max_failures = 1; }
+    else if (a == "--max-failures") { opt.max_failures = num(); }
+    else if (a == "--history") { opt.history = arg().data(); }  // in argv
+    else if (a == "--failed-first") { opt.failed_first = true; }
+    else if (a == "--jsonl") { opt.jsonl = arg().data(); }
+    else if (a == "--junit") { opt.junit = arg().data(); }
+    else if (a == "--profile") { opt.profile = arg().data(); }
+    else if (a == "--cache") { opt.cache = arg().data(); }
+    else if (a == "--counters") { opt.counters = true; }
+    else if (a == "--pin") { opt.bench_cpu = num(); }
+    else if ((a == "-x") || (a == "--exclude")) {
+      pats.push_back({Str(arg()), true});
+    }
+    else if (a.starts_with("-") && (a.size() > 1)) {
+      fprintf(stderr, "zest: unknown option %s\n", argv[i]);
+      fprintf(stderr, usage, argv[0]);
+      return 2;
+    }
+    else { pats.push_back({Str(a), false}); }
+  }
+  try {
+    for (auto& [p, x] : pats) { opt.filter.add(detail::Filter(p, regex, x)); }
+  } catch (const std::regex_error& e) {
+    fprintf(stderr, "zest: bad pattern: %s\n", e.what());
+    return 2;
+  }
+  int status = 0;
+  for (int i = 0; i < std::max(repeat, 1); ++i) {
+    status |= run(opt);
+    if (Runner::stopped) { break; }
+  }
+  return status;
+}
+
+ZEST_DEF detail::Out out() {
+  auto t = Runner::current;
+  if (!t) { return {{}, Runner::group_out ? *Runner::group_out : std::cout}; }
+  return t->output();
+}
+
+
+ZEST_DEF std::ostream& detail::stdout_stream() { return std::cout; }
+
+} // namespace zest
+#endif
+
+
+// The counting operator new for is_allocs_le/is_bytes_le, in every
+// form, so that each delete frees what its new allocated.
+#ifdef ZEST_COUNT_ALLOCS
+static bool zest_allocs_on = (zest::detail::Allocs::on = true);
+
+static inline void* zest_alloc(std::size_t n, std::size_t align) noexcept {
+  n = n ? n : 1;
+  ++zest::detail::Allocs::count;
+  zest::detail::Allocs::bytes += n;
+  return align ? std::aligned_alloc(align, (n + align - 1) / align * align)
+               : std::malloc(n);
+}
+
+static inline void* zest_new(std::size_t n, std::size_t align) {
+  if (auto p = zest_alloc(n, align)) { return p; }
+  throw std::bad_alloc();
+}
+
+// Once inlined, these free() what operator new returned, which GCC
+// takes for a mismatched pair.
+#pragma GCC diagnostic push
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t n) { return zest_new(n, 0); }
+void* operator new[](std::size_t n) { return zest_new(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a)
+{ return zest_new(n, (std::size_t)a); }
+void* operator new[](std::size_t n, std::align_val_t a)
+{ return zest_new(n, (std::size_t)a); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{ return zest_alloc(n, 0); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{ return zest_alloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a,
+                   const std::nothrow_t&) noexcept
+{ return zest_alloc(n, (std::size_t)a); }
+void* operator new[](std::size_t n, std::align_val_t a,
+                     const std::nothrow_t&) noexcept
+{ return zest_alloc(n, (std::size_t)a); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{ std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{ std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{ std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{ std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{ std::free(p); }
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept
+{ std::free(p); }
+#pragma GCC diagnostic pop
+#endif
 